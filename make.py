@@ -4,6 +4,8 @@
 from sandbox.eigen import task_eigen3
 from sandbox.samples import task_sample
 from sandbox.binaries import task_binary
+from sandbox.bench import task_bench
+from sandbox.check import task_check
 
 # script entry point.
 if __name__ == '__main__':
@@ -0,0 +1,51 @@
+
+# required imports.
+from doit.tools import create_folder
+import subprocess
+import json
+import os
+
+# task_bench: task generator for timing the solver and search kernels.
+def task_bench():
+  # bench: run the benchmark binaries, and store their results along
+  # with the source revision, so they can be compared across commits.
+  def bench(runs, rev, targets):
+    results = []
+    for binary, args in runs:
+      binfile = os.path.join('bin', binary)
+      proc = subprocess.run([binfile, *args], stdout=subprocess.PIPE,
+                            check=True)
+
+      lines = proc.stdout.decode('utf-8').strip().split('\n')
+      results += [{'binary': binary, **json.loads(line)}
+                  for line in lines if line]
+
+    with open(targets[0], 'w') as f:
+      json.dump({'rev': rev, 'results': results}, f, indent=2)
+
+  # ---
+
+  # get the current source revision.
+  proc = subprocess.run(['git', 'rev-parse', '--short', 'HEAD'],
+                        stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+  rev = proc.stdout.decode('utf-8').strip() or 'unknown'
+
+  # define the benchmark runs: every operator kind on a grid of sizes,
+  # on one thread and on all threads, and the gp search.
+  sizes = 'sizes=100x1000,250x1000,500x2000,1000x4000'
+  runs = [('bench', [sizes, f'kind={kind}', f'threads={threads}'])
+          for kind in ('dense', 'sparse', 'dct', 'dft')
+          for threads in (1, os.cpu_count())]
+  runs += [('bench-gp', [f'threads={threads}'])
+           for threads in (1, os.cpu_count())]
+
+  # yield the task.
+  benchdir = os.path.join('expts', 'bench')
+  return {
+    'actions': [(create_folder, [benchdir]),
+                (bench, [runs, rev])],
+    'file_dep': [os.path.join('bin', 'bench'),
+                 os.path.join('bin', 'bench-gp')],
+    'targets': [os.path.join(benchdir, f'{rev}.json')],
+    'uptodate': [False]
+  }
@@ -1,10 +1,13 @@
 
 # required imports.
-from doit.tools import create_folder
+from doit.tools import create_folder, config_changed
 from sandbox.util import binaries
 import subprocess
 import os
 
+# headers_inst: headers included by the common solver header.
+headers_inst = ('op.hh', 'fft.hh', 'rng.hh', 'cache.hh', 'trace.hh')
+
 # task_binary: task generator for compiling binaries from source.
 def task_binary():
   # binary: compile and link a binary from source.
@@ -31,12 +34,24 @@ def task_binary():
       if arg.startswith('{') and arg.endswith('}'):
         args[i] = arg.format(**fmt)
 
-    # determine the file dependencies.
+    # determine the file dependencies. headers included by the
+    # force-included header are tracked along with it.
     deps = []
     for arg in args:
       if arg in (source, header_gp, header_inst):
         deps.append(arg)
 
+    if header_inst in deps:
+      deps += [os.path.join('src', hdr) for hdr in headers_inst]
+
+    # the benchmarks share their timing helpers, and the gp benchmark
+    # includes the search code of gp-next.
+    if name in ('bench', 'bench-gp'):
+      deps.append(os.path.join('src', 'bench.hh'))
+
+    if name == 'bench-gp':
+      deps.append(os.path.join('src', 'gp-next.cc'))
+
     # yield a task.
     yield {
       'name': name,
@@ -44,6 +59,7 @@ def task_binary():
                   (binary, [args])],
       'file_dep': deps,
       'task_dep': ['eigen3'],
+      'uptodate': [config_changed(' '.join(args))],
       'targets': [target]
     }
 
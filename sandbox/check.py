@@ -0,0 +1,34 @@
+# required imports.
+from sandbox.util import execute
+import os
+
+# prunable: solvers that accept active-set pruning.
+prunable = ('irls-ec', 'irls-em', 'irls-map', 'vrls', 'vrls-ex')
+
+# task_check: task generator for checking that active-set pruning
+# leaves the solutions of the deterministic solvers unchanged.
+def task_check():
+  # check: solve one instance with and without pruning, and compare
+  # the residual norms of the two estimates.
+  def check(name, parms):
+    full = execute(name, {**parms, 'prune_every': 0})[1]['resid'][0]
+    pruned = execute(name, {**parms, 'prune_every': 20})[1]['resid'][0]
+    if abs(pruned - full) > 0.1 * full:
+      raise RuntimeError(f'{name}: resid {pruned} with pruning, '
+                         f'{full} without')
+
+  # ---
+
+  # a low-noise instance, on which a premature stop over the active
+  # columns leaves a visibly larger residual.
+  parms = {'k': 10, 'm': 500, 'n': 2000, 'stdev': 0.001,
+           'tau': 1e6, 'xi': 1e6, 'tol': 1e-6, 'metrics': 'y'}
+
+  # yield a task for each solver.
+  for name in prunable:
+    yield {
+      'name': name,
+      'actions': [(check, [name, parms])],
+      'file_dep': [os.path.join('bin', name)],
+      'uptodate': [False]
+    }
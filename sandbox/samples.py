@@ -1,102 +1,176 @@
 
 # required imports.
-from doit.tools import create_folder
-from sandbox.util import seeds, execute, surrogate
-import multiprocessing
-import subprocess
+from doit.tools import create_folder, config_changed
+from sandbox.util import seeds, sweep, surrogate, coords
 import pickle
 import gzip
 import os
 
-# execute_problem_dict: execute a solver for a single problem, given as
-# a tuple of (solver,parms), and return the result as a dictionary with
-# the resulting values substituted.
-def execute_problem_dict(problem):
-  (sol, parms) = problem
-  (out, err) = execute(sol, parms)
-  return {**parms, 'solver': sol, 'out': out, 'err': err}
-
 # task_sample: task generator for creating a random sample for each solver.
 def task_sample():
   # sample: create a random sample for each solver.
-  def sample(solvers, base_parms, sampdir, targets):
-    # subset: get the data for all matching (sol,k,m,n).
-    def subset(results, sol, k, m, n):
-      R = [r for r in results if r['solver'] == sol
-           and r['k'] == k and r['m'] == m and r['n'] == n]
-      return sorted(R, key=lambda r: r['seed'])
-
-    # nmse: compute the normalized mean squared error between x and x0.
-    def nmse(x, x0):
-      ss = sum((a - b)**2 for a, b in zip(x, x0))
-      ss0 = sum(b**2 for b in x0)
-      return ss / ss0
-
+  def sample(solvers, base_parms, sampdir, warm, targets):
     # meanvar: compute the mean and variance of the elements of x.
     def meanvar(x):
       mean = sum(x) / len(x)
       var = sum((el - mean)**2 for el in x)
       return (mean, var)
 
-    # metric: compute success rate statistics.
-    def metric(R, R0):
-      ss = [nmse(next(zip(*r['out'])), next(zip(*r0['out'])))
-            for r, r0 in zip(R, R0)]
+    # metric: compute success rate statistics from the normalized mean
+    # squared errors reported by the solvers.
+    def metric(R):
+      ss = [float(r['err']['nmse'][0]) for r in R]
       return meanvar(ss)
 
+    # create the directory of solver states, when warm-starting.
+    statedir = os.path.join(sampdir, 'state')
+    if warm:
+      os.makedirs(statedir, exist_ok=True)
+
     # get the standard deviation and precision for all experiments.
     stdev = base_parms['stdev']
     prec = 1 / stdev**2 if stdev > 0 else 1e9
 
-    # initialize a set of surrogate models, one per solver.
-    models = {sol: surrogate() for sol in solvers}
-
-    # run a set number of sampling iterations.
-    iters = 100
+    # initialize a set of surrogate models, one per solver, each
+    # proposing a batch of points per round.
+    batch = 4
+    models = {sol: surrogate(batch=batch) for sol in solvers}
+
+    # run_parms: get the run parameters of a solver.
+    def run_parms(sol):
+      # gibbs samplers are run for 10x fewer iterations, and all
+      # other solvers stop early once converged. every solver runs
+      # on a single thread, as the driver already occupies every core.
+      if 'grls' in sol:
+        parms = {'iters': 400, 'threads': 1}
+      else:
+        parms = {'iters': 5000, 'tol': 1e-6, 'threads': 1}
+
+      # extended algorithms get hyperpriors, others get priors.
+      if '-ex' in sol:
+        return {**parms, 'beta_tau': prec, 'beta_xi': prec}
+      else:
+        return {**parms, 'tau': prec, 'xi': prec}
+
+    # each model runs a set number of rounds, measuring the same total
+    # number of points as one proposal per round would. every proposal
+    # is measured by all solvers. a model proposes its next batch once
+    # its own solver has measured the last one, so fast solvers never
+    # wait on the gibbs samplers.
+    iters = 100 // batch
+    rounds = {sol: 0 for sol in solvers}
+    waiting = {sol: set() for sol in solvers}
+    measured = {}
+    submitted = {sol: [] for sol in solvers}
+    held = {}
+    done = set()
+    results = []
+    chunk = 0
     S = seeds()
-    with multiprocessing.Pool() as pool:
-      for it in range(iters):
-        # get one proposal from each surrogate model.
-        proposals = {next(models[sol]) for sol in solvers}
-
-        # construct a list of problems to execute.
-        problems = []
-        for sol in ['oracle', *solvers]:
-          # gibbs samplers are run for 10x fewer iterations.
-          if 'grls' in sol:
-            iters = 400
-          else:
-            iters = 5000
-
-          # extended algorithms get hyperpriors, others get priors.
-          if '-ex' in sol:
-            prior_parms = {'beta_tau': prec, 'beta_xi': prec}
-          else:
-            prior_parms = {'tau': prec, 'xi': prec}
-
-          # loop over each proposal.
-          for k, m, n in proposals:
-            size_parms = {'k': k, 'm': m, 'n': n}
+
+    # state: get the path of the final solver state of a problem.
+    def state(sol, point, seed):
+      (k, m, n) = point
+      return os.path.join(statedir, f'{sol}-k{k}-m{m}-n{n}-s{seed}')
+
+    # nearest: get the point nearest to a new point in the phase
+    # diagram among those submitted before it by the same model, or
+    # None. the choice only depends on the order of proposals, and not
+    # on the order in which the sweep completes its jobs.
+    def nearest(sol, point):
+      (d0, r0) = coords(*point)
+      prior = submitted[sol][:submitted[sol].index(point)]
+      dist = lambda p: sum((a - b)**2 for a, b in zip(coords(*p), (d0, r0)))
+      return min(prior, key=dist, default=None)
+
+    # propose: get a batch of proposals from a surrogate model, and
+    # submit each new point to every solver. with warm starts, each
+    # problem starts from the state of the same solver and seed at the
+    # nearest earlier point, and is held back until that state exists.
+    def propose(sol):
+      proposals = []
+      for i in range(batch):
+        point = next(models[sol])
+        if point not in proposals:
+          proposals.append(point)
+
+      rounds[sol] += 1
+      for point in proposals:
+        if point not in measured:
+          measured[point] = {s: [] for s in solvers}
+          submitted[sol].append(point)
+          near = nearest(sol, point) if warm else None
+          (k, m, n) = point
+          for s in solvers:
             for seed in S:
-              parms = {**base_parms, **prior_parms, **size_parms,
-                       'iters': iters, 'seed': seed}
-              problems.append((sol, parms))
-
-        # measure every proposal with each solver.
-        results = pool.map(execute_problem_dict, problems)
-
-        # store the results into a pickle file.
-        filename = os.path.join(sampdir, f'{it}.gz')
-        with gzip.open(filename, 'wb') as f:
-          pickle.dump(results, f)
-
-        # add the results into the surrogate models.
-        for k, m, n in proposals:
-          R0 = subset(results, 'oracle', k, m, n)
-          for sol in solvers:
-            R = subset(results, sol, k, m, n)
-            (y, dy) = metric(R, R0)
-            models[sol].add(k, m, n, y, dy)
+              parms = {**base_parms, **run_parms(s),
+                       'k': k, 'm': m, 'n': n, 'seed': seed}
+              if not warm:
+                driver.submit(s, parms)
+                continue
+
+              parms['save'] = state(s, point, seed)
+              if near is None or (s, near, seed) in done:
+                if near is not None:
+                  parms['init'] = state(s, near, seed)
+
+                driver.submit(s, parms)
+              else:
+                parms['init'] = state(s, near, seed)
+                held.setdefault((s, near, seed), []).append(parms)
+
+        # wait on the points not yet measured by the solver.
+        if len(measured[point][sol]) < len(S):
+          waiting[sol].add(point)
+
+    # start the sweep driver, and the first round of every model.
+    driver = sweep(workers=os.cpu_count())
+    for sol in solvers:
+      propose(sol)
+
+    # collect the results as they complete.
+    for (sol, parms, out, err) in driver:
+      r = {**parms, 'solver': sol, 'out': out, 'err': err}
+      results.append(r)
+
+      # release the problems warm-started from this one.
+      point = (r['k'], r['m'], r['n'])
+      done.add((sol, point, r['seed']))
+      for held_parms in held.pop((sol, point, r['seed']), []):
+        driver.submit(sol, held_parms)
+
+      # once a point is measured on all seeds, add it to the model.
+      R = measured[point][sol]
+      R.append(r)
+      if len(R) < len(S):
+        continue
+
+      (y, dy) = metric(sorted(R, key=lambda r: r['seed']))
+      models[sol].add(*point, y, dy)
+      waiting[sol].discard(point)
+
+      # once a round is complete, store its results into a pickle
+      # file, and start the next round of the model.
+      while not waiting[sol] and rounds[sol] < iters:
+        if results:
+          filename = os.path.join(sampdir, f'{chunk}.gz')
+          with gzip.open(filename, 'wb') as f:
+            pickle.dump(results, f)
+
+          chunk += 1
+          results = []
+
+        propose(sol)
+
+    # store any remaining results.
+    if results:
+      filename = os.path.join(sampdir, f'{chunk}.gz')
+      with gzip.open(filename, 'wb') as f:
+        pickle.dump(results, f)
+
+    driver.close()
+    for sol in solvers:
+      models[sol].close()
 
     # store the phase diagram data into pickle files.
     for sol in solvers:
@@ -113,22 +187,30 @@ def task_sample():
   # define the set of noise standard deviations.
   stdev = (0, 0.001, 0.01, 0.1)
 
+  # the phase diagrams are measured from cold starts, unless warm starts
+  # from nearby points are requested by IRLS_WARM=1 in the environment.
+  warm = (os.environ.get('IRLS_WARM') == '1')
+
   # yield one task per standard deviation.
   for s in stdev:
-    # set the sample and binary directories.
+    # set the sample, instance cache and binary directories.
     sampdir = os.path.join('expts', 'samples', str(s))
+    cachedir = os.path.join('expts', 'cache')
     bindir = 'bin'
 
-    # set the base parameters.
-    parms = {'stdev': s}
+    # set the base parameters. every solver shares each generated
+    # instance through the cache, and returns its error metrics against
+    # the ground truth as binary results.
+    parms = {'stdev': s, 'cache': cachedir, 'out': 'bin', 'metrics': True}
 
     # yield a task.
     yield {
       'name': str(s),
       'actions': [(create_folder, [sampdir]),
-                  (sample, [solvers, parms, sampdir])],
-      'file_dep': [os.path.join(bindir, sol)
-                   for sol in ['oracle', *solvers]],
+                  (sample, [solvers, parms, sampdir, warm])],
+      'file_dep': [os.path.join(bindir, sol) for sol in solvers] +
+                  [os.path.join(bindir, 'sweep')],
+      'uptodate': [config_changed(str(warm))],
       'targets': [os.path.join(sampdir, f'{sol}.gz')
                   for sol in solvers]
     }
@@ -1,5 +1,6 @@
 
 # required imports.
+import numpy as np
 import subprocess
 import random
 import os
@@ -19,19 +20,33 @@ def solvers():
 # binaries: return a dictionary of all compilable binaries.
 def binaries():
   # args: build a compilation argument string list.
-  def args(cxx='g++', omp=False, incl=None):
+  def args(cxx='g++', omp=False, pthread=False, trace=False, incl=None):
     return ([cxx, f'-std=c++17', f'-O3', '-I.', '-Ieigen3'] +
             (['-include', f'{{{incl}}}'] if incl else []) +
             (['-fopenmp'] if omp else []) +
+            (['-pthread'] if pthread else []) +
+            (['-DIRLS_TRACE'] if trace else []) +
             (['{source}', '-o', '{target}']))
 
+  # the solvers are compiled with their tracing hooks when IRLS_TRACE=1
+  # is set in the environment.
+  trace = (os.environ.get('IRLS_TRACE') == '1')
+
   return {
-    # solver algorithms.
-    **{sol: args(incl='inst') for sol in solvers()},
+    # solver algorithms. instances are generated in parallel, and the
+    # gibbs samplers also run their chains in parallel.
+    **{sol: args(incl='inst', omp=True, trace=trace) for sol in solvers()},
 
     # gaussian process utilities.
     'gp-init': args(incl='gp'),
-    'gp-next': args(incl='gp', omp=True)
+    'gp-next': args(incl='gp', omp=True),
+
+    # sweep driver, running solver servers on a pool of threads.
+    'sweep': args(pthread=True),
+
+    # kernel benchmarks of the solvers and of the gp search.
+    'bench': args(incl='inst', omp=True),
+    'bench-gp': args(incl='gp', omp=True)
   }
 
 
@@ -41,22 +56,167 @@ def parse(lines):
                for line in lines.strip().split('\n'))
 
 
-# execute: execute a binary with a set of parameters.
-def execute(binary, parms={}, inp=None):
-  # build the binary filename and the arguments list.
-  binfile = os.path.join('bin', binary)
+# parse_bin: parse a binary result record (written with out=bin) into
+# an array of (estimate, variance) rows and a dictionary of diagnostics.
+# the arrays are views of the record bytes, so nothing is copied.
+def parse_bin(buf):
+  # read the header.
+  header = np.frombuffer(buf, dtype='<u8', count=4)
+  if bytes(buf[:8]) != b'irlsres\0':
+    raise RuntimeError('invalid binary result')
+
+  (n, ndiag) = (int(header[1]), int(header[2]))
+  offset = 32
+
+  # read the estimate and variance.
+  out = np.frombuffer(buf, dtype='<f8', count=2 * n, offset=offset)
+  out = out.reshape(2, n).T
+  offset += 16 * n
+
+  # read the diagnostics.
+  err = {}
+  for i in range(ndiag):
+    key = bytes(buf[offset:offset + 16]).rstrip(b'\0').decode('utf-8')
+    num = int(np.frombuffer(buf, dtype='<u8', count=1, offset=offset + 16)[0])
+    err[key] = np.frombuffer(buf, dtype='<f8', count=num, offset=offset + 24)
+    offset += 24 + 8 * num
+
+  return (out, err)
+
+
+# server: class for managing a resident solver process, which reads
+# one job per line on stdin and writes one framed record per job.
+class server:
+  def __init__(self, binary):
+    binfile = os.path.join('bin', binary)
+    self.proc = subprocess.Popen([binfile, 'serve=-'],
+                                 stdin=subprocess.PIPE,
+                                 stdout=subprocess.PIPE)
+
+  def run(self, args):
+    # write the job line.
+    self.proc.stdin.write((' '.join(args) + '\n').encode('utf-8'))
+    self.proc.stdin.flush()
+
+    # read the record header and the framed stdout and stderr bytes.
+    header = self.proc.stdout.readline()
+    if not header:
+      raise RuntimeError('solver server exited unexpectedly')
+
+    (nout, nerr) = (int(field) for field in header.split())
+    out = self.proc.stdout.read(nout)
+    err = self.proc.stdout.read(nerr).decode('utf-8')
+    return (out, err)
+
+  def close(self):
+    self.proc.stdin.close()
+    self.proc.wait()
+
+
+# servers: resident solver processes of the current python process.
+servers = {}
+
+
+# diag: parse diagnostic lines of the form 'key value...' into a
+# dictionary of tuples.
+def diag(lines):
+  fields = (line.split() for line in lines.strip().split('\n'))
+  return {f[0]: tuple(float(el) for el in f[1:]) for f in fields if f}
+
+
+# execute: execute a binary with a set of parameters. when persist is
+# true, the job is sent to a resident server process for the binary.
+# when parms holds 'out': 'bin', the result is parsed from binary.
+def execute(binary, parms={}, inp=None, persist=False):
+  # build the arguments list.
   args = [f'{key}={str(val).lower()}' for key, val in parms.items()]
 
-  # execute the binary.
-  proc = subprocess.run([binfile, *args], input=inp, encoding='utf-8',
-                        stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+  # if requested, run the job on a resident server.
+  if persist:
+    if binary not in servers:
+      servers[binary] = server(binary)
+
+    (out, err) = servers[binary].run(args)
+    if err.startswith('error'):
+      raise RuntimeError(f'{binary}: {err.strip()}')
+
+  else:
+    # execute the binary.
+    binfile = os.path.join('bin', binary)
+    proc = subprocess.run([binfile, *args],
+                          input=inp.encode('utf-8') if inp else None,
+                          stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+    (out, err) = (proc.stdout, proc.stderr.decode('utf-8'))
 
   # parse stdout and stderr.
-  out = parse(proc.stdout)
-  err = parse(proc.stderr)
+  return decode(out, err, parms)
+
+
+# decode: parse the stdout bytes and stderr string of a solver run.
+# when parms holds 'out': 'bin', the result is parsed from binary.
+def decode(out, err, parms):
+  if parms.get('out') == 'bin':
+    return parse_bin(out)
+
+  return (parse(out.decode('utf-8')), diag(err))
+
+
+# sweep: class for managing a sweep driver process, which runs jobs on a
+# work-stealing pool of resident solver servers and streams each result
+# back as soon as it completes. jobs sharing an instance through the
+# 'cache' parameter wait until the first of them has generated it.
+class sweep:
+  def __init__(self, parms={}, workers=0):
+    # start the driver, passing the parameters shared by all jobs.
+    binfile = os.path.join('bin', 'sweep')
+    args = [f'{key}={str(val).lower()}' for key, val in parms.items()]
+    self.proc = subprocess.Popen([binfile, f'workers={workers}', *args],
+                                 stdin=subprocess.PIPE,
+                                 stdout=subprocess.PIPE)
+
+    # store the shared parameters, and the submitted jobs by index.
+    self.parms = parms
+    self.jobs = {}
+    self.count = 0
+
+  def submit(self, binary, parms):
+    # write the job line, and remember the job by its index.
+    args = [f'{key}={str(val).lower()}' for key, val in parms.items()]
+    line = ' '.join([binary, *args]) + '\n'
+    self.proc.stdin.write(line.encode('utf-8'))
+    self.proc.stdin.flush()
+    self.jobs[self.count] = (binary, parms)
+    self.count += 1
+
+  def __iter__(self):
+    return self
 
-  # return the result.
-  return (out, err)
+  def __next__(self):
+    # stop once every submitted job has returned.
+    if not self.jobs:
+      raise StopIteration
+
+    # read the record header and the framed stdout and stderr bytes.
+    header = self.proc.stdout.readline()
+    if not header:
+      raise RuntimeError('sweep driver exited unexpectedly')
+
+    (idx, nout, nerr) = (int(field) for field in header.split())
+    out = self.proc.stdout.read(nout)
+    err = self.proc.stdout.read(nerr).decode('utf-8')
+
+    # parse the result of the job.
+    (binary, parms) = self.jobs.pop(idx)
+    if err.startswith('error'):
+      raise RuntimeError(f'{binary}: {err.strip()}')
+
+    (out, err) = decode(out, err, {**self.parms, **parms})
+    return (binary, parms, out, err)
+
+  def close(self):
+    self.proc.stdin.close()
+    self.proc.wait()
 
 
 # coords: map between phase-diagram coordinates and instance coordinates.
@@ -82,12 +242,15 @@ def coords(*args):
 
 
 # surrogate: class for managing gaussian process-based surrogate models.
+# each proposal yields a batch of points, selected by fantasized
+# observations so that they spread over the phase diagram.
 class surrogate:
-  def __init__(self, seed=0, grid=100, threads=4):
+  def __init__(self, seed=0, grid=100, threads=4, batch=1):
     # store the sampler parameters.
     self.seed = seed
     self.grid = grid
     self.threads = threads
+    self.batch = batch
 
     # initialize two arrays: one for proposed (unmeasured) samples
     # and another for measured samples.
@@ -95,6 +258,10 @@ class surrogate:
     self.proposals = []
     self.samples = []
 
+    # the resident gp-next process, and the number of samples it holds.
+    self.proc = None
+    self.sent = 0
+
   def __next__(self):
     # propose an initial set of random and edge points.
     if not self.prepared:
@@ -102,7 +269,7 @@ class surrogate:
 
     # if the proposal point set has been depleted, generate more.
     if len(self.proposals) == 0:
-      self.propose()
+      self.propose(self.batch)
 
     # pop a and return proposed point from the list.
     return coords(*self.proposals.pop())
@@ -122,13 +289,38 @@ class surrogate:
     self.prepared = True
 
   def propose(self, num=1):
-    # build the input string.
-    inp = '\n'.join(' '.join(str(f) for f in s) for s in self.samples)
-
-    # execute the gp-next binary.
-    args = {'num': num, 'threads': self.threads}
-    (out, err) = execute('gp-next', args, inp)
-
-    # store the proposed points.
-    self.proposals += list(out)
+    # start a resident gp-next process, which keeps the factorization
+    # of its kernel matrix between proposals.
+    if self.proc is None:
+      binfile = os.path.join('bin', 'gp-next')
+      self.proc = subprocess.Popen([binfile, 'serve=-'],
+                                   stdin=subprocess.PIPE,
+                                   stdout=subprocess.PIPE,
+                                   encoding='utf-8')
+
+    # send the new samples, followed by the search request.
+    lines = [' '.join(str(f) for f in s) for s in self.samples[self.sent:]]
+    lines.append(f'num={num} threads={self.threads} batch=believer')
+    self.proc.stdin.write('\n'.join(lines) + '\n')
+    self.proc.stdin.flush()
+    self.sent = len(self.samples)
+
+    # read and store the proposed points, which may be fewer than
+    # requested, as counted by the leading line. a failed search is
+    # answered by an error line before a zero count.
+    line = self.proc.stdout.readline()
+    if line.startswith('error'):
+      self.proc.stdout.readline()
+      raise RuntimeError(f'gp-next: {line[6:].strip()}')
+
+    count = int(line)
+    out = [self.proc.stdout.readline() for i in range(count)]
+    self.proposals += list(parse(''.join(out)))
+
+  def close(self):
+    # stop the resident gp-next process.
+    if self.proc is not None:
+      self.proc.stdin.close()
+      self.proc.wait()
+      self.proc = None
 
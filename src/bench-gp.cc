@@ -0,0 +1,112 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#include <omp.h>
+#include "bench.hh"
+
+/* include the search code of gp-next, without its main function. */
+#define GP_NEXT_NO_MAIN
+#include "gp-next.cc"
+
+/* benchmark parameters:
+ *
+ *  @sizes: comma-separated list of benchmark sizes, each as "NxG" for
+ *   N observations and G grid points along each dimension. the batch
+ *   size is set by "num=".
+ */
+std::string sizes = "100x100,400x100,1600x100,400x300";
+
+/* bench(): time repeated calls of a phase function, and write the mean
+ * time per call as one json line, along with the memory bandwidth and
+ * floating-point rate implied by nominal byte and flop counts.
+ */
+template<typename F>
+static void bench(const std::string& phase, int N, double bytes,
+                  double flops, F&& f) {
+  /* time the phase, if requested. */
+  std::size_t reps = 0;
+  double t = 0;
+  if (!bench_time(phase, f, reps, t))
+    return;
+
+  /* write the results. */
+  std::cout << "{\"phase\": \"" << phase << "\", \"N\": " << N
+            << ", \"grid\": " << ns << ", \"threads\": " << threads
+            << ", \"reps\": " << reps << ", \"ns\": " << t * 1e9
+            << ", \"gbps\": " << bytes / t * 1e-9
+            << ", \"gflops\": " << flops / t * 1e-9 << "}" << std::endl;
+}
+
+/* run(): time each search phase on a random dataset of N observations.
+ */
+static void run(int N) {
+  /* draw the dataset. */
+  std::default_random_engine gen{rs};
+  std::uniform_real_distribution<double> unif{0, 1};
+  std::vector<point> X;
+  std::vector<double> y, dy;
+  for (int i = 0; i < N; i++) {
+    X.push_back({unif(gen), unif(gen)});
+    y.push_back(unif(gen));
+    dy.push_back(0.01);
+  }
+
+  /* the bulk cholesky factorization of a one-shot search. */
+  model gp;
+  bench("assign", N, 8.0 * N * N, N * double(N) * N / 3 + 20.0 * N * N,
+        [&] { gp.assign(X, y, dy); });
+
+  /* the separable kernel tables of the grid scan. */
+  const double G = feasible().size(), tiles = std::ceil(G / 64);
+  bench("tables", N, 16.0 * N * ns, 40.0 * N * ns,
+        [&] { tables tab{X, dy}; });
+
+  /* the exact grid scan: one triangular solve per tile. */
+  const predictor P{gp};
+  bench("scan", N, tiles * 4.0 * N * N + 16.0 * N * ns,
+        G * (double(N) * N + 4.0 * N), [&] { scan(P); });
+
+  /* the complete searches: the points of highest utility, and a batch
+   * of @n points under fantasized observations, each of which costs a
+   * kernel solve and a covariance with every grid point.
+   */
+  bench("search", N, tiles * 4.0 * N * N + 16.0 * N * ns,
+        G * (double(N) * N + 4.0 * N), [&] { search(P); });
+
+  bench("batch", N, tiles * 4.0 * N * N + n * 8.0 * G * N,
+        G * (double(N) * N + 4.0 * N) + n * (2.0 * N * N + 2.0 * G * N),
+        [&] { search_batch(gp, P); });
+
+  /* the inducing-point grid scan, including the fit. */
+  const double M = inducing * inducing;
+  approx = "fitc";
+  bench("scan-fitc", N, tiles * 8.0 * M * M + 8.0 * N * M,
+        G * 2.0 * M * M + 2.0 * N * M * M,
+        [&] { const predictor Q{gp, inducing}; scan(Q); });
+
+  approx = "exact";
+}
+
+int main(int argc, char **argv) {
+  /* split the benchmark arguments from the search arguments. */
+  const auto args = bench_args(argc, argv, sizes);
+
+  /* set up the threads. */
+  gp_args(args);
+  omp_set_num_threads(threads);
+  Eigen::setNbThreads(1);
+
+  /* time the phases for each size. */
+  for (const auto& size : split(sizes)) {
+    const auto idx = size.find_first_of('x');
+    if (idx == std::string::npos)
+      throw std::invalid_argument("invalid size '" + size + "'");
+
+    ns = std::stoi(size.substr(idx + 1));
+    run(std::stoi(size.substr(0, idx)));
+  }
+
+  return 0;
+}
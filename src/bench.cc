@@ -0,0 +1,132 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#include "bench.hh"
+
+/* benchmark parameters:
+ *
+ *  @sizes: comma-separated list of instance sizes, each as "MxN".
+ */
+std::string sizes = "100x1000,250x1000,500x2000";
+
+/* bench(): time repeated calls of a phase function, and write the mean
+ * time per call as one json line, along with the memory bandwidth and
+ * floating-point rate implied by nominal byte and flop counts.
+ */
+template<typename F>
+static void bench(const std::string& phase, double bytes, double flops,
+                  F&& f) {
+  /* time the phase, if requested. */
+  std::size_t reps = 0;
+  double t = 0;
+  if (!bench_time(phase, f, reps, t))
+    return;
+
+  /* determine the number of threads in use. */
+  std::size_t nth = 1;
+#ifdef _OPENMP
+  nth = omp_get_max_threads();
+#endif
+
+  /* write the results. */
+  std::cout << "{\"phase\": \"" << phase << "\", \"kind\": \"" << kind
+            << "\", \"m\": " << m << ", \"n\": " << n
+            << ", \"threads\": " << nth << ", \"reps\": " << reps
+            << ", \"ns\": " << t * 1e9
+            << ", \"gbps\": " << bytes / t * 1e-9
+            << ", \"gflops\": " << flops / t * 1e-9 << "}" << std::endl;
+}
+
+/* product(): return the nominal bytes read and flops of one product
+ * with the sensing operator.
+ */
+static std::pair<double, double> product() {
+  if (kind.compare("dense") == 0)
+    return {8.0 * (m * n + m + n), 2.0 * m * n};
+
+  if (kind.compare("sparse") == 0) {
+    /* csr values and column indices, plus the vectors. */
+    const double nnz = std::min(d, m) * double(n);
+    return {12.0 * nnz + 8.0 * (m + n), 2.0 * nnz};
+  }
+
+  /* fast transforms: one complex fft of length 2n. */
+  const double len = 2.0 * n;
+  return {16.0 * len + 8.0 * m, 5.0 * len * std::log2(len)};
+}
+
+/* run(): time each solver phase on the current problem instance.
+ */
+static void run() {
+  const auto [pb, pf] = product();
+
+  /* prepare the vectors used by the phases. */
+  Eigen::VectorXd x = x0, r{m}, g{n};
+  Eigen::VectorXd w = (x.array().abs2() + 1e-6).sqrt().inverse();
+  Eigen::VectorXd lambda = y;
+
+  /* operator products, as in every x-update. */
+  bench("apply", pb, pf, [&] { A->apply(x, r); });
+  bench("adjoint", pb, pf, [&] { A->adjoint(r, g); });
+
+  /* the data-misfit gradient of the mm solvers. */
+  bench("grad", pb, 2 * pf, [&] { grad(x, 1, g); });
+
+  /* the irls-ec dual ascent step. */
+  bench("dual", 2 * pb, 2 * pf, [&] {
+    lambda += y - A * x;
+    g = (A.transpose() * lambda).cwiseQuotient(w);
+  });
+
+  /* the weight update of the irls solvers. */
+  bench("weights", 16.0 * n, 4.0 * n, [&] {
+    w = (x.array().abs2() + 1e-6).sqrt().inverse();
+  });
+
+  /* the gramian and its cholesky factorization, in the direct x-draw
+   * of the gibbs samplers.
+   */
+  const Eigen::VectorXd winv = w.cwiseInverse();
+  const double dc = std::min(d, m);
+  const double gb = (kind.compare("dense") == 0 ? 8.0 * m * n :
+                     kind.compare("sparse") == 0 ? 12.0 * dc * n :
+                     2.0 * m * pb) + 8.0 * m * m;
+  const double gf = (kind.compare("dense") == 0 ? 2.0 * m * m * n :
+                     kind.compare("sparse") == 0 ? 2.0 * dc * dc * n :
+                     2.0 * m * pf);
+
+  Eigen::MatrixXd G;
+  bench("gram", gb, gf, [&] { G = A->gram(winv); });
+
+  Eigen::LLT<Eigen::MatrixXd> llt(m);
+  G.diagonal().array() += 1;
+  bench("chol", 8.0 * m * m, m * m * m / 3.0, [&] { llt.compute(G); });
+
+  /* one matrix-free product of the conjugate-gradient x-draw. */
+  bench("cg", 2 * pb + 24.0 * n, 2 * pf + 3.0 * n, [&] {
+    g = A.transpose() * (A * x) + w.cwiseProduct(x);
+  });
+}
+
+int main(int argc, char **argv) {
+  /* split the benchmark arguments from the instance arguments. */
+  const auto args = bench_args(argc, argv, sizes);
+
+  /* time the phases on an instance of each size. */
+  for (const auto& size : split(sizes)) {
+    const auto idx = size.find_first_of('x');
+    if (idx == std::string::npos)
+      throw std::invalid_argument("invalid size '" + size + "'");
+
+    auto iargs = args;
+    iargs.push_back("m=" + size.substr(0, idx));
+    iargs.push_back("n=" + size.substr(idx + 1));
+    inst_reset();
+    inst_init(iargs);
+    run();
+  }
+
+  return 0;
+}
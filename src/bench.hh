@@ -0,0 +1,80 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* benchmark parameters shared by the benchmark binaries:
+ *
+ *  @phases: comma-separated list of phases to time, or empty for all.
+ *  @min_time: minimum time spent repeating each phase, in seconds.
+ */
+std::string phases;
+double min_time = 0.25;
+
+/* split(): split a comma-separated list.
+ */
+static std::vector<std::string> split(const std::string& list) {
+  std::vector<std::string> vals;
+  std::istringstream iss(list);
+  for (std::string val; std::getline(iss, val, ',');)
+    vals.push_back(val);
+
+  return vals;
+}
+
+/* bench_args(): split the benchmark arguments, i.e. the list of sizes
+ * and the above parameters, from the remaining arguments.
+ */
+static std::vector<std::string> bench_args(int argc, char **argv,
+                                           std::string& sizes) {
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg.compare(0, 6, "sizes=") == 0)
+      sizes = arg.substr(6);
+    else if (arg.compare(0, 7, "phases=") == 0)
+      phases = arg.substr(7);
+    else if (arg.compare(0, 9, "min_time=") == 0)
+      min_time = std::stod(arg.substr(9));
+    else
+      args.push_back(arg);
+  }
+
+  return args;
+}
+
+/* bench_time(): time repeated calls of a phase function, unless the
+ * phase was not requested. returns whether it was timed, along with
+ * the number of calls and the mean time per call.
+ */
+template<typename F>
+static bool bench_time(const std::string& phase, F&& f,
+                       std::size_t& reps, double& t) {
+  /* skip phases that were not requested. */
+  const auto sel = split(phases);
+  if (!sel.empty() && std::find(sel.begin(), sel.end(), phase) == sel.end())
+    return false;
+
+  /* warm up, then repeat until the minimum time has passed. */
+  using clock = std::chrono::steady_clock;
+  f();
+  reps = 0;
+  double elapsed = 0;
+  const auto t0 = clock::now();
+  do {
+    f();
+    reps++;
+    elapsed = std::chrono::duration<double>(clock::now() - t0).count();
+  }
+  while (elapsed < min_time);
+
+  t = elapsed / reps;
+  return true;
+}
@@ -0,0 +1,107 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* mapping: read-only memory mapping of a complete file.
+ *
+ * mappings are shared by pointer, so that any data viewed through them
+ * (e.g. a cached sensing matrix) keeps the file mapped while in use.
+ */
+struct mapping {
+public:
+  /* open(): map a file, or return null if it cannot be read.
+   */
+  static std::shared_ptr<const mapping> open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return nullptr;
+
+    /* map the file contents. the mapping outlives the descriptor. */
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+      addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+    if (addr == MAP_FAILED)
+      return nullptr;
+
+    return std::shared_ptr<const mapping>{new mapping(addr, st.st_size)};
+  }
+
+  /* ~mapping(): destructor, unmaps the file.
+   */
+  ~mapping() { munmap(addr, len); }
+
+  /* data(), size(): return the mapped bytes and their count.
+   */
+  const char *data() const { return static_cast<const char*>(addr); }
+  std::size_t size() const { return len; }
+
+private:
+  /* mapping(): private constructor, takes an established mapping.
+   */
+  mapping(void *a, std::size_t l) : addr{a}, len{l} {}
+  mapping(const mapping&) = delete;
+  mapping& operator=(const mapping&) = delete;
+
+  /* struct members:
+   *
+   *  @addr: address of the mapped bytes.
+   *  @len: number of mapped bytes.
+   */
+  void *addr;
+  std::size_t len;
+};
+
+/* write_atomic(): write a sequence of buffers to a file.
+ *
+ * the bytes are written to a temporary file in the same directory,
+ * which is then renamed over the destination. concurrent readers thus
+ * see either no file or a complete file, and concurrent writers of the
+ * same contents may safely race.
+ */
+static void
+write_atomic(const std::string& path,
+             const std::vector<std::pair<const void*, std::size_t>>& bufs) {
+  /* create the temporary file. */
+  std::string tmp = path + ".XXXXXX";
+  const int fd = mkstemp(&tmp[0]);
+  if (fd < 0)
+    throw std::runtime_error("failed to create '" + tmp + "'");
+
+  /* make the file readable by other workers. */
+  fchmod(fd, 0644);
+
+  /* write each buffer completely. */
+  bool ok = true;
+  for (const auto& buf : bufs) {
+    const char *p = static_cast<const char*>(buf.first);
+    std::size_t left = buf.second;
+    while (ok && left > 0) {
+      const ssize_t num = write(fd, p, left);
+      ok = (num > 0);
+      p += (ok ? num : 0);
+      left -= (ok ? num : 0);
+    }
+  }
+
+  /* move the complete file into place. */
+  ok = (close(fd) == 0) && ok;
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    throw std::runtime_error("failed to write '" + path + "'");
+  }
+}
@@ -0,0 +1,150 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#pragma once
+#include <complex>
+#include <vector>
+#include <cmath>
+
+/* fft: planned complex discrete fourier transform of arbitrary length.
+ *
+ * power-of-two lengths are transformed by an iterative radix-2 scheme.
+ * all other lengths are transformed by bluestein's algorithm, which
+ * re-expresses the transform as a circular convolution computed by
+ * radix-2 transforms of the next power of two of at least 2N-1.
+ */
+struct fft {
+public:
+  using cplx = std::complex<double>;
+  using cvec = std::vector<cplx>;
+
+  /* fft(): constructor, takes the transform length.
+   */
+  fft(std::size_t len = 1) : N{len}, M{1} {
+    /* determine the radix-2 transform length. */
+    if (N & (N - 1)) {
+      while (M < 2 * N - 1)
+        M <<= 1;
+    }
+    else
+      M = N;
+
+    /* compute the radix-2 twiddle factors, stored contiguously for
+     * each stage: the stage of length 2h uses tw[h-1] to tw[2h-2].
+     */
+    tw.resize(M > 1 ? M - 1 : 1);
+    for (std::size_t h = 1; h < M; h <<= 1)
+      for (std::size_t k = 0; k < h; k++)
+        tw[h - 1 + k] = std::polar(1.0, -pi * k / h);
+
+    /* for non-power-of-two lengths, prepare the bluestein chirps. */
+    if (M != N) {
+      /* compute the chirp, reducing k^2 modulo 2N for accuracy. */
+      chirp.resize(N);
+      for (std::size_t k = 0; k < N; k++) {
+        const std::size_t k2 = (k * k) % (2 * N);
+        chirp[k] = std::polar(1.0, -pi * k2 / N);
+      }
+
+      /* compute the transformed convolution filter. */
+      filt.assign(M, 0);
+      filt[0] = std::conj(chirp[0]);
+      for (std::size_t k = 1; k < N; k++)
+        filt[k] = filt[M - k] = std::conj(chirp[k]);
+
+      radix2(filt, false);
+    }
+  }
+
+  /* size(): return the transform length.
+   */
+  std::size_t size() const { return N; }
+
+  /* operator(): compute the unnormalized forward (exp(-i...)) or
+   * inverse (exp(+i...)) transform of a length-N vector in place.
+   */
+  void operator()(cvec& x, bool inverse = false) const {
+    /* power-of-two lengths are transformed directly. */
+    if (M == N) {
+      radix2(x, inverse);
+      return;
+    }
+
+    /* the inverse transform is the conjugate of the forward transform
+     * of the conjugated input.
+     */
+    if (inverse)
+      for (auto& el : x)
+        el = std::conj(el);
+
+    /* multiply by the chirp and convolve with the filter. */
+    cvec a(M, 0);
+    for (std::size_t k = 0; k < N; k++)
+      a[k] = mul(x[k], chirp[k]);
+
+    radix2(a, false);
+    for (std::size_t k = 0; k < M; k++)
+      a[k] = mul(a[k], filt[k]);
+
+    radix2(a, true);
+
+    /* demodulate, scaling by the length of the convolution. */
+    for (std::size_t k = 0; k < N; k++)
+      x[k] = mul(a[k], chirp[k]) / double(M);
+
+    if (inverse)
+      for (auto& el : x)
+        el = std::conj(el);
+  }
+
+private:
+  /* mul(): complex product, expanded by hand to avoid the library's
+   * checks for infinite and not-a-number operands.
+   */
+  static cplx mul(const cplx& a, const cplx& b) {
+    return {a.real() * b.real() - a.imag() * b.imag(),
+            a.real() * b.imag() + a.imag() * b.real()};
+  }
+
+  /* radix2(): unnormalized in-place radix-2 transform of length M.
+   */
+  void radix2(cvec& x, bool inverse) const {
+    /* permute the input into bit-reversed order. */
+    for (std::size_t i = 1, j = 0; i < M; i++) {
+      std::size_t bit = M >> 1;
+      for (; j & bit; bit >>= 1)
+        j ^= bit;
+
+      j ^= bit;
+      if (i < j)
+        std::swap(x[i], x[j]);
+    }
+
+    /* compute the butterflies of each stage. */
+    for (std::size_t h = 1; h < M; h <<= 1) {
+      const cplx *w = tw.data() + h - 1;
+      for (std::size_t i = 0; i < M; i += 2 * h) {
+        for (std::size_t k = 0; k < h; k++) {
+          const cplx v = mul(x[i + k + h], inverse ? std::conj(w[k]) : w[k]);
+          const cplx u = x[i + k];
+          x[i + k] = u + v;
+          x[i + k + h] = u - v;
+        }
+      }
+    }
+  }
+
+  /* struct members:
+   *
+   *  @N: transform length.
+   *  @M: radix-2 transform length.
+   *  @tw: radix-2 twiddle factors.
+   *  @chirp: bluestein chirp sequence.
+   *  @filt: transformed bluestein convolution filter.
+   */
+  static constexpr double pi = 3.14159265358979323846264338327950288;
+  std::size_t N, M;
+  cvec tw, chirp, filt;
+};
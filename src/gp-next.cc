@@ -3,6 +3,447 @@
  * Released under the MIT License.
  */
 
+/* feasible(): return the linearized indices of all feasible grid
+ * points, computed once per grid size.
+ */
+static const std::vector<int>& feasible() {
+  static int size = 0;
+  static std::vector<int> idx;
+  if (size == ns)
+    return idx;
+
+  idx.clear();
+  for (int ii = 0; ii < ns * ns; ii++) {
+    /* compute the grid point indices from the linearized index. */
+    const int uidx = ii % ns;
+    const int vidx = (ii - uidx) / ns;
+
+    /* keep feasible points. */
+    if (mask(double(uidx) / ns, double(vidx) / ns))
+      idx.push_back(ii);
+  }
+
+  size = ns;
+  return idx;
+}
+
+/* tables: separable kernel tables of a set of points over the grid.
+ *
+ * the squared-exponential kernel between a data point and a grid
+ * point is the product of one-dimensional kernels along each axis,
+ * and grid coordinates are multiples of 1/ns. kernel vectors are thus
+ * formed from two tables of N-by-ns kernel values, costing only O(N)
+ * multiplies and no exponentials per grid point.
+ */
+struct tables {
+public:
+  /* tables(): constructor, takes the points and their measurement
+   * noise values.
+   */
+  tables(const std::vector<point>& X, const std::vector<double>& noise)
+   : Ku{int(X.size()), ns}, Kv{int(X.size()), ns}, dy{noise} {
+    /* compute the per-axis kernel values. */
+    const int N = X.size();
+    for (int g = 0; g < ns; g++) {
+      const double t = double(g) / ns;
+      for (int i = 0; i < N; i++) {
+        Ku(i,g) = kernel({X[i](0), 0}, {t, 0}, 0);
+        Kv(i,g) = kernel({X[i](1), 0}, {t, 0}, 0);
+      }
+    }
+
+    /* find the points that coincide with grid points, which receive
+     * their measurement noise in kernel().
+     */
+    for (int i = 0; i < N; i++) {
+      const int uidx = std::round(X[i](0) * ns);
+      const int vidx = std::round(X[i](1) * ns);
+      if (uidx >= 0 && uidx < ns && vidx >= 0 && vidx < ns &&
+          X[i] == point{double(uidx) / ns, double(vidx) / ns})
+        on.push_back({vidx * ns + uidx, i});
+    }
+
+    std::sort(on.begin(), on.end());
+  }
+
+  /* column(): compute the kernel vector between the points and the
+   * grid point of a linearized index.
+   */
+  template<typename Vector>
+  void column(int ii, Vector&& k) const {
+    /* multiply the table columns. */
+    const int uidx = ii % ns;
+    const int vidx = (ii - uidx) / ns;
+    k = Ku.col(uidx).cwiseProduct(Kv.col(vidx));
+
+    /* add the noise of any coinciding data points. */
+    auto it = std::lower_bound(on.begin(), on.end(), std::make_pair(ii, 0));
+    for (; it != on.end() && it->first == ii; it++)
+      k(it->second) += dy[it->second];
+  }
+
+private:
+  /* struct members:
+   *
+   *  @Ku, @Kv: kernel values along each axis, one row per point and
+   *   one column per grid coordinate.
+   *  @on: sorted linearized grid indices of coinciding points, paired
+   *   with the point indices.
+   *  @dy: measurement noise of each point.
+   */
+  Eigen::MatrixXd Ku, Kv;
+  std::vector<std::pair<int, int>> on;
+  std::vector<double> dy;
+};
+
+/* predictor: gp posterior predictive distribution at grid points.
+ *
+ * predictions are made from the kernel vector k of each grid point
+ * against a set of basis points:
+ *
+ *   mean = k' * alpha
+ *   var = k(x,x) - |inv(L1) * k|^2 + |inv(L2) * inv(L1) * k|^2
+ *
+ * for an exact gp, the basis is the dataset, L1 is the cholesky factor
+ * of the kernel matrix, and the last term is absent. for an inducing-
+ * point approximation, the basis is a coarse grid of M points, L1 is
+ * the cholesky factor of their kernel matrix Kuu, and L2 is that of
+ *
+ *   B = I + V * inv(Lambda) * V',  V = inv(L1) * Kuf,
+ *
+ * where Lambda holds the measurement noise ("dtc"), plus the diagonal
+ * of Kff - Kfu * inv(Kuu) * Kuf ("fitc"). both keep the exact prior
+ * variance k(x,x), so neither collapses far from the inducing points
+ * as a subset of regressors would. fitting then costs O(NM^2), and
+ * each prediction costs O(M^2).
+ */
+struct predictor {
+public:
+  /* predictor(): constructor for an exact gp, takes a model with an
+   * up-to-date cholesky factor.
+   */
+  predictor(const model& gp)
+   : tab{gp.X, gp.dy}, alpha{gp.weights()}, L1{&gp.L}, sparse{false} {}
+
+  /* predictor(): constructor for an inducing-point approximation,
+   * takes a model and the number of inducing points per axis.
+   */
+  predictor(const model& gp, int mi)
+   : tab{inducing(mi), std::vector<double>(mi * mi, 0)},
+     L1{&Luu}, sparse{true} {
+    /* compute the factor of the inducing kernel matrix, with a small
+     * jitter for numerical stability.
+     */
+    const std::vector<point> U = inducing(mi);
+    const int N = gp.size(), M = U.size();
+    Eigen::MatrixXd K{M, M};
+    for (int a = 0; a < M; a++)
+      for (int b = 0; b < M; b++)
+        K(a,b) = kernel(U[a], U[b], 0) + (a == b ? 1e-6 : 0);
+
+    Luu = K.llt().matrixL();
+
+    /* compute the whitened cross-kernel matrix. */
+    Eigen::MatrixXd V{M, N};
+    for (int i = 0; i < N; i++)
+      for (int a = 0; a < M; a++)
+        V(a,i) = kernel(U[a], gp.X[i], 0);
+
+    Luu.triangularView<Eigen::Lower>().solveInPlace(V);
+
+    /* compute the diagonal noise precisions. */
+    Eigen::VectorXd lam{N};
+    for (int i = 0; i < N; i++) {
+      double li = gp.dy[i];
+      if (approx.compare("fitc") == 0)
+        li += std::max(0.0, 1 - V.col(i).squaredNorm());
+
+      lam(i) = 1 / std::max(li, 1e-8);
+    }
+
+    /* factorize B, and compute the mean weights. */
+    Eigen::MatrixXd B = Eigen::MatrixXd::Identity(M, M);
+    B.noalias() += V * lam.asDiagonal() * V.transpose();
+    L2 = B.llt().matrixL();
+
+    const Eigen::VectorXd yv =
+      Eigen::Map<const Eigen::VectorXd>(gp.y.data(), N);
+
+    alpha = V * lam.cwiseProduct(yv);
+    L2.triangularView<Eigen::Lower>().solveInPlace(alpha);
+    L2.triangularView<Eigen::Lower>().transpose().solveInPlace(alpha);
+    Luu.triangularView<Eigen::Lower>().transpose().solveInPlace(alpha);
+  }
+
+  /* size(): return the number of basis points.
+   */
+  int size() const { return alpha.size(); }
+
+  /* reduce(): replace a tile of kernel columns by their whitened
+   * values, and return the resulting variance reductions.
+   */
+  Eigen::VectorXd reduce(Eigen::Ref<Eigen::MatrixXd> Kt) const {
+    L1->triangularView<Eigen::Lower>().solveInPlace(Kt);
+    Eigen::VectorXd r = Kt.colwise().squaredNorm().transpose();
+    if (sparse) {
+      L2.triangularView<Eigen::Lower>().solveInPlace(Kt);
+      r -= Kt.colwise().squaredNorm().transpose();
+    }
+
+    return r;
+  }
+
+  /* weights(): return the weights w of a kernel vector k, such that
+   * the posterior covariance of any grid point with its grid point is
+   * k(x,xq) minus the dot product of its kernel vector with w.
+   */
+  Eigen::VectorXd weights(const Eigen::VectorXd& k) const {
+    const auto T1 = L1->triangularView<Eigen::Lower>();
+    Eigen::VectorXd w = k;
+    T1.solveInPlace(w);
+    if (sparse) {
+      Eigen::VectorXd b = w;
+      L2.triangularView<Eigen::Lower>().solveInPlace(b);
+      L2.triangularView<Eigen::Lower>().transpose().solveInPlace(b);
+      w -= b;
+    }
+
+    T1.transpose().solveInPlace(w);
+    return w;
+  }
+
+  /* struct members:
+   *
+   *  @tab: kernel tables of the basis points.
+   *  @alpha: mean weights.
+   *  @Luu, @L2: factors of the inducing-point approximation.
+   *  @L1: first factor, either of the model or of the approximation.
+   *  @sparse: whether the approximation is used.
+   */
+  tables tab;
+  Eigen::VectorXd alpha;
+  Eigen::MatrixXd Luu, L2;
+  const Eigen::MatrixXd *L1;
+  bool sparse;
+
+private:
+  predictor(const predictor&) = delete;
+
+  /* inducing(): return the inducing points, at the cell centers of a
+   * coarse grid.
+   */
+  static std::vector<point> inducing(int mi) {
+    std::vector<point> U;
+    for (int b = 0; b < mi; b++)
+      for (int a = 0; a < mi; a++)
+        U.push_back({(a + 0.5) / mi, (b + 0.5) / mi});
+
+    return U;
+  }
+};
+
+/* grid: feasible grid points, with their gp posterior predictive
+ * means and variances.
+ */
+struct grid {
+  std::vector<int> idx;
+  std::vector<point> x;
+  Eigen::VectorXd mean, var;
+};
+
+/* scan(): compute the gp posterior predictive means and variances of
+ * all feasible grid points.
+ *
+ * the grid is scanned in tiles of points, so the kernel columns of
+ * each tile are solved against the cholesky factors at once.
+ */
+static grid scan(const predictor& P) {
+  /* declare the basis size. */
+  const int N = P.size();
+
+  /* gather the feasible grid points. */
+  grid g;
+  g.idx = feasible();
+  for (int ii : g.idx) {
+    const int uidx = ii % ns;
+    const int vidx = (ii - uidx) / ns;
+    g.x.push_back({double(uidx) / ns, double(vidx) / ns});
+  }
+
+  const int G = g.x.size();
+  g.mean.resize(G);
+  g.var.resize(G);
+
+  constexpr int T = 64;
+  #pragma omp parallel
+  {
+    /* declare thread-local tile variables. */
+    Eigen::MatrixXd Ks{N, T};
+
+    /* scan in parallel. */
+    #pragma omp for
+    for (int t0 = 0; t0 < G; t0 += T) {
+      /* compute the kernel columns. */
+      const int cnt = std::min(T, G - t0);
+      auto Kt = Ks.leftCols(cnt);
+      for (int c = 0; c < cnt; c++)
+        P.tab.column(g.idx[t0 + c], Kt.col(c));
+
+      /* compute the means and variances. */
+      g.mean.segment(t0, cnt).noalias() = Kt.transpose() * P.alpha;
+      const Eigen::VectorXd r = P.reduce(Kt);
+      for (int c = 0; c < cnt; c++)
+        g.var(t0 + c) = kernel(g.x[t0 + c], g.x[t0 + c], 0) - r(c);
+    }
+  }
+
+  return g;
+}
+
+/* search(): find the grid points with maximal utility.
+ */
+static hit_list search(const predictor& P) {
+  const grid g = scan(P);
+  hit_list hits{n};
+  for (std::size_t i = 0; i < g.x.size(); i++)
+    hits.update(g.x[i], util(g.mean(i), g.var(i), exploit));
+
+  return hits;
+}
+
+/* search_batch(): select a batch of grid points one at a time, each
+ * with maximal utility after fantasized observations at the points
+ * already selected.
+ *
+ * each fantasy is a rank-one update of the grid posterior. under the
+ * kriging believer, the fantasized value is the predicted mean, which
+ * leaves the means unchanged. under the constant liar, it is the mean
+ * of the observed values. only the variances are reduced, so nearby
+ * points lose utility and the batch spreads out.
+ */
+static std::vector<point> search_batch(const model& gp,
+                                       const predictor& P) {
+  /* scan the grid under the current model. */
+  grid g = scan(P);
+  const int N = gp.size(), M = P.size(), G = g.x.size();
+
+  /* compute the value of the constant liar. */
+  double lie = 0;
+  for (double yi : gp.y)
+    lie += yi / N;
+
+  /* declare the posterior covariances with the selected points. */
+  std::vector<Eigen::VectorXd> C;
+  std::vector<bool> taken(G, false);
+  std::vector<point> batch;
+
+  for (int q = 0; q < n; q++) {
+    /* select the untaken point with maximal utility. */
+    int best = -1;
+    double ubest = 0;
+    for (int i = 0; i < G; i++) {
+      const double u = util(g.mean(i), g.var(i), exploit);
+      if (!taken[i] && (best < 0 || u > ubest)) {
+        best = i;
+        ubest = u;
+      }
+    }
+
+    if (best < 0)
+      break;
+
+    taken[best] = true;
+    batch.push_back(g.x[best]);
+    if (q + 1 == n)
+      break;
+
+    /* solve for the kernel weights of the selected point. */
+    const point xq = g.x[best];
+    Eigen::VectorXd w{M};
+    P.tab.column(g.idx[best], w);
+    w = P.weights(w);
+
+    /* compute the posterior covariances of all grid points with the
+     * selected point, under the previous fantasies.
+     */
+    Eigen::VectorXd c{G};
+    #pragma omp parallel
+    {
+      Eigen::VectorXd k{M};
+
+      #pragma omp for
+      for (int i = 0; i < G; i++) {
+        P.tab.column(g.idx[i], k);
+        double ci = kernel(g.x[i], xq, 0) - k.dot(w);
+        for (const auto& Cp : C)
+          ci -= Cp(i) * Cp(best);
+
+        c(i) = ci;
+      }
+    }
+
+    /* apply the fantasized observation. */
+    const double D = c(best);
+    if (D <= 0)
+      continue;
+
+    c /= std::sqrt(D);
+    if (batch_mode.compare("liar") == 0)
+      g.mean += c * (lie - g.mean(best)) / std::sqrt(D);
+
+    g.var -= c.cwiseAbs2();
+    C.push_back(c);
+  }
+
+  return batch;
+}
+
+/* the output and main functions are left out when this file is
+ * included by the benchmark binary.
+ */
+#ifndef GP_NEXT_NO_MAIN
+/* print(): search for new points, and print them to stdout, after a
+ * line holding their number if @framed is set.
+ */
+static void print(model& gp, bool framed = false) {
+  /* build the exact or approximate predictor. */
+  std::unique_ptr<predictor> P;
+  if (approx.compare("exact") == 0) {
+    gp.factor();
+    P = std::make_unique<predictor>(gp);
+  }
+  else if (approx.compare("dtc") == 0 || approx.compare("fitc") == 0)
+    P = std::make_unique<predictor>(gp, inducing);
+  else
+    throw std::invalid_argument("unknown approximation '" + approx + "'");
+
+  /* check the batch mode. */
+  if (batch_mode.compare("none") != 0 &&
+      batch_mode.compare("believer") != 0 &&
+      batch_mode.compare("liar") != 0)
+    throw std::invalid_argument("unknown batch mode '" + batch_mode + "'");
+
+  /* search. */
+  std::ostringstream oss;
+  std::size_t count = n;
+  if (batch_mode.compare("none") == 0)
+    oss << search(*P);
+  else {
+    /* batches may run out of candidates before @n points. */
+    const auto batch = search_batch(gp, *P);
+    for (const auto& x : batch)
+      oss << x(0) << " " << x(1) << "\n";
+
+    count = batch.size();
+  }
+
+  /* print the results. */
+  if (framed)
+    std::cout << count << "\n";
+
+  std::cout << oss.str() << std::flush;
+}
+
 int main(int argc, char **argv) {
   /* initialize. */
   gp_init(argc, argv);
@@ -11,6 +452,49 @@ int main(int argc, char **argv) {
   omp_set_num_threads(threads);
   Eigen::setNbThreads(1);
 
+  /* in server mode, read one line at a time from stdin. lines of four
+   * numbers are new observations, which extend the model. any other
+   * line holds key=value arguments for a search, which is run on the
+   * current model and answered by the number of points, followed by
+   * the points, or by an error line and a zero count if it fails.
+   * arguments only apply to their own search.
+   */
+  model gp;
+  if (serve.compare("-") == 0) {
+    for (std::string line; std::getline(std::cin, line);) {
+      /* try to read an observation. */
+      std::istringstream iss(line);
+      double s[4];
+      if (iss >> s[0] >> s[1] >> s[2] >> s[3]) {
+        gp.add({s[0], s[1]}, s[2], s[3]);
+        continue;
+      }
+
+      /* otherwise, parse the arguments and search. */
+      std::vector<std::string> args;
+      iss.clear();
+      iss.str(line);
+      for (std::string arg; iss >> arg;)
+        args.push_back(arg);
+
+      gp_reset();
+      gp_args(args);
+      omp_set_num_threads(threads);
+
+      /* a failed search is answered by an error line and an empty
+       * result, so that the server stays up for later requests.
+       */
+      try {
+        print(gp, true);
+      }
+      catch (const std::exception& e) {
+        std::cout << "error " << e.what() << "\n0\n" << std::flush;
+      }
+    }
+
+    return 0;
+  }
+
   /* declare vectors for holding the current dataset. */
   std::vector<point> X;
   std::vector<double> y, dy;
@@ -28,64 +512,14 @@ int main(int argc, char **argv) {
     }
   }
 
-  /* declare the hit list and dataset size. */
-  hit_list hits{n};
-  const int N = X.size();
-
-  /* compute the kernel matrix elements. */
-  Eigen::MatrixXd K{N, N};
-  for (int i = 0; i < N; i++)
-    for (int j = 0; j < N; j++)
-      K(i,j) = kernel(X[i], X[j], dy[i]);
-
-  /* compute the data vector. */
-  Eigen::VectorXd yv{N};
-  for (int i = 0; i < N; i++)
-    yv(i) = y[i];
-
-  /* decompose the kernel matrix. */
-  auto lltK = K.llt();
-  Eigen::VectorXd alpha = lltK.solve(yv);
-
-  /* search all grid points to find the points with maximal utility. */
-  #pragma omp declare reduction(+: hit_list: omp_out += omp_in)
-  #pragma omp parallel reduction(+: hits)
-  {
-    /* declare thread-local vectors. */
-    point xs;
-    Eigen::VectorXd ks{N};
-
-    /* search in parallel. */
-    #pragma omp for
-    for (int ii = 0; ii < ns * ns; ii++) {
-      /* compute the grid point indices from the linearized index. */
-      const int uidx = ii % ns;
-      const int vidx = (ii - uidx) / ns;
-
-      /* compute the grid point values. */
-      const double u = double(uidx) / ns;
-      const double v = double(vidx) / ns;
-
-      /* skip infeasible points. */
-      if (!mask(u, v))
-        continue;
-
-      /* compute the kernel vector. */
-      xs = {u, v};
-      for (int i = 0; i < N; i++)
-        ks(i) = kernel(X[i], xs, dy[i]);
-
-      /* compute the gp posterior predictive mean and variance. */
-      const double mean = ks.dot(alpha);
-      const double var = kernel(xs, xs, 0) - ks.dot(lltK.solve(ks));
-
-      /* compute the utility value. */
-      const double Us = util(mean, var, exploit);
-      hits.update(xs, Us);
-    }
+  /* build the model, and print the selected points. */
+  gp.assign(X, y, dy);
+  try {
+    print(gp);
+  }
+  catch (const std::exception& e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
   }
-
-  /* print the hit list. */
-  std::cout << hits;
 }
-
+#endif
@@ -4,8 +4,13 @@
  */
 
 #pragma once
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <sstream>
 #include <utility>
+#include <tuple>
 #include <string>
 #include <random>
 #include <vector>
@@ -29,12 +34,24 @@ using seed = std::default_random_engine::result_type;
  *  @rs: random seed value, if complete determinism is needed.
  *  @threads: number of threads to use for utility evaluation.
  *  @exploit: whether to exploit or not. if not, just explore.
+ *  @batch_mode: how multiple points are selected, set by "batch=":
+ *   "none" for the points of highest utility, or "believer" or "liar"
+ *   for sequential selection under fantasized observations.
+ *  @approx: gaussian process used in searches: "exact", or "dtc" or
+ *   "fitc" for an inducing-point approximation.
+ *  @inducing: number of inducing points along each dimension.
+ *  @serve: "-" to stay resident, reading observations and requests
+ *   from stdin, or empty to read one dataset and exit.
  */
 int n = 1;
 int ns = 100;
 seed rs = 0;
 int threads = 4;
 bool exploit = false;
+std::string batch_mode = "none";
+std::string approx = "exact";
+int inducing = 10;
+std::string serve;
 
 /* hit_list: maintains a sorted (descending) list of hits.
  */
@@ -152,13 +169,120 @@ bool mask(double delta, double rho) {
          std::round(rho * delta * n) >= 1;
 }
 
-/* gp_init(): initialize the application arguments.
+/* model: gaussian process model of a growing dataset, holding the
+ * cholesky factor of its kernel matrix.
+ *
+ * each new observation extends the factor by one row, computed by a
+ * single triangular solve in O(N^2) time, so the factorization is
+ * never recomputed from scratch. the extension is deferred until the
+ * factor is needed, so approximate searches never pay for it.
  */
-void gp_init(int argc, char **argv) {
-  /* parse the runtime arguments. */
-  for (std::size_t i = 1; i < argc; i++) {
+struct model {
+public:
+  /* size(): return the number of observations.
+   */
+  int size() const { return X.size(); }
+
+  /* assign(): replace the dataset, factorizing its kernel matrix at
+   * once.
+   */
+  void assign(const std::vector<point>& Xn, const std::vector<double>& yn,
+              const std::vector<double>& dyn) {
+    /* store the dataset. */
+    X = Xn;
+    y = yn;
+    dy = dyn;
+
+    /* compute the kernel matrix elements. */
+    const int N = size();
+    Eigen::MatrixXd K{N, N};
+    for (int i = 0; i < N; i++)
+      for (int j = 0; j < N; j++)
+        K(i,j) = kernel(X[i], X[j], dy[i]);
+
+    /* decompose the kernel matrix. */
+    L = K.llt().matrixL();
+  }
+
+  /* add(): append an observation.
+   */
+  void add(const point& x, double yi, double dyi) {
+    X.push_back(x);
+    y.push_back(yi);
+    dy.push_back(dyi);
+  }
+
+  /* factor(): extend the cholesky factor over all observations.
+   */
+  void factor() {
+    for (int N = L.rows(); N < size(); N++) {
+      /* compute the kernel row of the next observation. */
+      Eigen::VectorXd k{N};
+      for (int j = 0; j < N; j++)
+        k(j) = kernel(X[N], X[j], dy[N]);
+
+      /* solve for the new row of the factor. */
+      L.triangularView<Eigen::Lower>().solveInPlace(k);
+      const double d = std::sqrt(kernel(X[N], X[N], dy[N]) - k.squaredNorm());
+
+      /* store the extended factor. */
+      L.conservativeResize(N + 1, N + 1);
+      L.row(N).head(N) = k.transpose();
+      L.col(N).setZero();
+      L(N,N) = d;
+    }
+  }
+
+  /* weights(): return the kernel weight vector inv(K) * y, given an
+   * up-to-date factor.
+   */
+  Eigen::VectorXd weights() const {
+    Eigen::VectorXd alpha =
+      Eigen::Map<const Eigen::VectorXd>(y.data(), y.size());
+
+    const auto T = L.triangularView<Eigen::Lower>();
+    T.solveInPlace(alpha);
+    T.transpose().solveInPlace(alpha);
+    return alpha;
+  }
+
+  /* struct members:
+   *
+   *  @X: observed points.
+   *  @y: observed values.
+   *  @dy: observed value uncertainties.
+   *  @L: lower cholesky factor of the kernel matrix.
+   */
+  std::vector<point> X;
+  std::vector<double> y, dy;
+  Eigen::MatrixXd L;
+};
+
+/* gp_parms(): return references to all runtime-settable parameters.
+ */
+auto gp_parms() {
+  return std::tie(n, ns, rs, threads, exploit, batch_mode, approx,
+                  inducing, serve);
+}
+
+/* gp_reset(): restore all parameters to their values at the first
+ * call, i.e. after the command line has been parsed.
+ */
+void gp_reset() {
+  /* take a snapshot of the parameters on the first call. */
+  static const auto defaults =
+    std::apply([] (auto&... p) { return std::make_tuple(p...); },
+               gp_parms());
+
+  /* restore the snapshot. */
+  gp_parms() = defaults;
+}
+
+/* gp_args(): parse a list of key=value runtime arguments.
+ */
+void gp_args(const std::vector<std::string>& args) {
+  for (const auto& arg : args) {
     /* get the current argument. */
-    std::string arg(argv[i]);
     auto idx = arg.find_first_of('=');
     if (idx == std::string::npos)
       continue;
@@ -172,18 +296,31 @@ void gp_init(int argc, char **argv) {
     else if (key.compare("seed")    == 0) { rs = std::stoi(val); }
     else if (key.compare("grid")    == 0) { ns = std::stoi(val); }
     else if (key.compare("num")     == 0) { n = std::stoi(val); }
+    else if (key.compare("serve")   == 0) { serve = val; }
+    else if (key.compare("batch")   == 0) { batch_mode = val; }
+    else if (key.compare("approx")  == 0) { approx = val; }
+    else if (key.compare("inducing") == 0) { inducing = std::stoi(val); }
     else if (key.compare("exploit") == 0) {
-      if (val.compare("y") == 0 ||
-          val.compare("yes") == 0 ||
-          val.compare("true") == 0)
-        exploit = true;
+      exploit = (val.compare("y") == 0 ||
+                 val.compare("yes") == 0 ||
+                 val.compare("true") == 0);
     }
   }
+}
+
+/* gp_init(): initialize the application arguments.
+ */
+void gp_init(int argc, char **argv) {
+  /* parse the runtime arguments. */
+  gp_args(std::vector<std::string>(argv + 1, argv + argc));
 
   /* if no seed was specified, obtain a random seed. */
   if (rs == 0) {
     std::random_device rdev;
     rs = rdev();
   }
+
+  /* keep the parsed values as the defaults of later requests. */
+  gp_reset();
 }
 
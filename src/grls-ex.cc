@@ -3,96 +3,160 @@
  * Released under the MIT License.
  */
 
-int main(int argc, char **argv) {
-  /* initialize the problem instance. */
-  inst_init(argc, argv);
-
+/* solve(): run the solver on the current problem instance.
+ */
+static void solve(std::ostream& out, std::ostream& err) {
   /* initialize variables for running mean and variance computations. */
-  Eigen::VectorXd M1, M2, mu, gamma;
-  M1.resize(n);
-  M2.resize(n);
-  mu.resize(n);
-  gamma.resize(n);
-  M1.setZero();
-  M2.setZero();
-  mu.setZero();
-  gamma.setZero();
-
-  /* initialize variables for sampling values of x. */
-  Eigen::VectorXd z1, z2, z3, u, t;
-  z1.resize(m);
-  z2.resize(n);
-  z3.resize(n);
-  u.resize(n);
-  t.resize(m);
-
-  /* initialize the sample of x. */
-  Eigen::VectorXd x;
-  x.resize(n);
-  x.setZero();
-
-  /* initialize the weight sample. */
-  Eigen::VectorXd w;
-  w.resize(n);
-  w.setOnes();
-
-  /* randomly re-seed the pseudorandom number generator. */
-  std::random_device rdev;
-  gen.seed(rdev());
+  chain_stats stats{n, chains, iters};
+  Eigen::VectorXd mu, gamma;
+
+  /* initialize variables for sampling values of x, with one column
+   * per chain.
+   */
+  Eigen::MatrixXd Z1, Z2, Z3, R;
+  Z1.resize(m, chains);
+  Z2.resize(n, chains);
+
+  /* initialize the samples of x. */
+  Eigen::MatrixXd X;
+  X.resize(n, chains);
+  X.setZero();
+
+  /* initialize the weight samples. */
+  Eigen::MatrixXd W;
+  W.resize(n, chains);
+  W.setOnes();
+
+  /* initialize the noise precision and weight precision samples. */
+  Eigen::VectorXd taus, xis;
+  taus.setConstant(chains, tau);
+  xis.setConstant(chains, xi);
+
+  /* if available, warm-start the chains from a prior state, which
+   * may shorten the burn-in once the chains are seen to mix.
+   */
+  const bool warm = inst_warm("X", "x", X) && inst_warm("W", "w", W);
+  burnin burn{warm};
+  double tau0 = tau, xi0 = xi;
+  if (!inst_warm("taus", taus) && inst_warm("tau", tau0))
+    taus.setConstant(tau0);
+
+  if (!inst_warm("xis", xis) && inst_warm("xi", xi0))
+    xis.setConstant(xi0);
+
+  /* precompute the projected data vector. */
+  const Eigen::VectorXd Aty = A.transpose() * y;
+
+  /* seed one reproducible pseudorandom stream per chain. */
+  std::vector<stream> rs;
+  for (std::size_t c = 0; c < chains; c++)
+    rs.emplace_back(seed, c);
 
   /* iterate. */
-  for (std::size_t it = 0; it < burn_iters + iters; it++) {
-    /* draw an m-vector of standard normal variates. */
-    for (std::size_t j = 0; j < m; j++)
-      z1(j) = nrm(gen);
-
-    /* draw an n-vector of standard normal variates. */
-    for (std::size_t i = 0; i < n; i++)
-      z2(i) = nrm(gen);
-
-    /* z3 = sqrt(tau) .* A' * z1 + sqrt(w) .* z2 */
-    z3 = std::sqrt(tau) * A.transpose() * z1 +
-         w.cwiseSqrt().cwiseProduct(z2);
-
-    /* sample x:
-     *  u = tau .* A' * y + z3
-     *  t = (eye(m) ./ tau + A * diag(1 ./ w) * A') \ (A * (u ./ w))
-     *  x = (u - A' * t) ./ w;
+  for (std::size_t it = 0; it < burn.len + iters; it++) {
+    /* draw m- and n-vectors of standard normal variates. */
+    TRACE_PHASE(aux);
+    #pragma omp parallel for
+    for (std::size_t c = 0; c < chains; c++) {
+      rs[c].normal(Z1.col(c));
+      rs[c].normal(Z2.col(c));
+    }
+
+    /* Z3 = sqrt(tau) .* A' * Z1 + sqrt(W) .* Z2,
+     * with the products of all chains computed at once.
      */
-    u = tau * A.transpose() * y + z3;
-    t.setConstant(1 / tau);
-    auto llt = (Eigen::MatrixXd{t.asDiagonal()} +
-                A * w.cwiseInverse().asDiagonal() * A.transpose()).llt();
-    t = llt.solve(A * u.cwiseQuotient(w));
-    x = (u - A.transpose() * t).cwiseQuotient(w);
-
-    /* sample w. */
-    for (std::size_t i = 0; i < n; i++)
-      w(i) = igrnd(std::sqrt(xi) / (std::abs(x(i)) + 1e-6), xi);
-
-    /* sample xi. */
-    xi = igrnd(std::sqrt(beta_xi / w.array().inverse().sum()), beta_xi);
-
-    /* sample tau. */
-    tau = igrnd(std::sqrt(beta_tau / (y - A * x).squaredNorm()), beta_tau);
-
-    /* check if the sample should be stored. */
-    if (it >= burn_iters) {
-      /* compute the sample count. */
-      const double S = (it - burn_iters) + 1;
-
-      /* update the first moment of x. */
-      M1 = x - mu;
-      mu += M1 / S;
-
-      /* update the second moment of x. */
-      M2 += M1.cwiseProduct(x - mu);
-      gamma = M2 / S;
+    A->adjoint_cols(Z1, Z3);
+    Z3 = Z3 * taus.cwiseSqrt().asDiagonal() + W.cwiseSqrt().cwiseProduct(Z2);
+
+    /* sample x, w and xi in each chain. */
+    TRACE_PHASE(x);
+    #pragma omp parallel for
+    for (std::size_t c = 0; c < chains; c++) {
+      Eigen::VectorXd x = X.col(c), w = W.col(c), u, t;
+      const double tau = taus(c), xi = xis(c);
+
+      /* sample x:
+       *  u = tau .* A' * y + z3
+       *  t = (eye(m) ./ tau + A * diag(1 ./ w) * A') \ (A * (u ./ w))
+       *  x = (u - A' * t) ./ w;
+       */
+      u = tau * Aty + Z3.col(c);
+      if (xdraw.compare("cg") == 0) {
+        /* or, matrix-free: solve (tau .* A' * A + diag(w)) * x = u by
+         * conjugate gradients, starting from the previous sample.
+         */
+        auto Q = [&] (const Eigen::VectorXd& v) -> Eigen::VectorXd {
+          return tau * (A.transpose() * (A * v)) + w.cwiseProduct(v);
+        };
+        pcg(Q, (w + tau * delta).cwiseInverse(), u, x, cg_tol, cg_iters);
+      }
+      else {
+        t.setConstant(m, 1 / tau);
+        auto llt = (Eigen::MatrixXd{t.asDiagonal()} +
+                    A->gram(w.cwiseInverse())).llt();
+        t = llt.solve(A * u.cwiseQuotient(w));
+        x = (u - A.transpose() * t).cwiseQuotient(w);
+      }
+
+      /* sample w. */
+      igrnd(std::sqrt(xi) / (x.array().abs() + 1e-6),
+            Eigen::ArrayXd::Constant(n, xi), w, rs[c]);
+
+      /* sample xi. */
+      xis(c) = igrnd(std::sqrt(beta_xi / w.array().inverse().sum()),
+                     beta_xi, rs[c]);
+
+      /* check if the sample should be stored. */
+      if (it >= burn.len)
+        stats.update(c, it - burn.len, x);
+
+      X.col(c) = x;
+      W.col(c) = w;
     }
+
+    /* compute the residuals of all chains at once. */
+    TRACE_PHASE(aux);
+    A->apply_cols(X, R);
+    R = (-R).colwise() + y;
+
+    /* sample tau in each chain. */
+    for (std::size_t c = 0; c < chains; c++)
+      taus(c) = igrnd(std::sqrt(beta_tau / R.col(c).squaredNorm()),
+                      beta_tau, rs[c]);
+
+    /* check whether a warm burn-in has mixed. */
+    burn.update(it, X);
+
+    /* sample the first chain. */
+    TRACE_ITER(it + 1, X.col(0), W.col(0), taus(0));
   }
 
-  /* output the final mean and variance estimates. */
-  for (std::size_t i = 0; i < n; i++)
-    std::cout << mu(i) << " " << gamma(i) << "\n";
+  /* store the final state, along with the mean estimate, weights and
+   * precisions.
+   */
+  stats.pooled(mu, gamma);
+  inst_keep("X", Eigen::Map<const Eigen::VectorXd>(X.data(), X.size()));
+  inst_keep("W", Eigen::Map<const Eigen::VectorXd>(W.data(), W.size()));
+  inst_keep("taus", taus);
+  inst_keep("xis", xis);
+  inst_keep("x", mu);
+  inst_keep("w", W.rowwise().mean());
+  inst_keep("tau", taus.mean());
+  inst_keep("xi", xis.mean());
+
+  /* output the final pooled mean and variance estimates. */
+  inst_output(out, err, mu, gamma);
+
+  /* output the convergence diagnostic. */
+  if (iters >= 4)
+    inst_diag(err, "rhat", stats.rhat());
+
+  /* output the burn-in length of warm-started chains. */
+  if (warm)
+    inst_diag(err, "burn", burn.len);
 }
 
+int main(int argc, char **argv) {
+  /* solve the problem instance. */
+  return inst_main(argc, argv, solve);
+}
@@ -5,10 +5,35 @@
 
 #pragma once
 #include <limits>
+#include <algorithm>
 #include <random>
 #include <string>
+#include <vector>
+#include <tuple>
+#include <map>
+#include <initializer_list>
+#include <array>
+#include <cstring>
+#include <cstdio>
+#include <sstream>
 #include <iostream>
+#include <stdexcept>
 #include <Eigen/Dense>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "op.hh"
+#include "rng.hh"
+#include "cache.hh"
+
+#ifdef IRLS_TRACE
+#include "trace.hh"
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /* problem instance variables:
  *
@@ -19,8 +44,13 @@
  *  @seed: pseudorandom number generator seed.
  *  @stdev: standard deviation of the measurement errors.
  *  @orth: whether or not to orthogonalize the sensing matrix rows.
+ *  @kind: type of sensing operator: "dense" for a gaussian matrix,
+ *   "sparse" for a sparse random sign matrix, or "dct" or "dft" for
+ *   a randomly subsampled cosine or real fourier transform.
+ *  @d: number of nonzero entries per column of sparse matrices.
+ *  @cache: directory of cached instances, or empty to always generate.
  *
- *  @A: measurement/sensing matrix, @m by @n.
+ *  @A: measurement/sensing operator, @m by @n.
  *  @x0: ground truth solution vector.
  *  @y: measured signal vector.
  *  @delta: diagonal of the sensing matrix gramian.
@@ -32,7 +62,10 @@ std::size_t n = 100;
 std::size_t seed = 47251;
 double stdev = 0.001;
 bool orth = false;
-Eigen::MatrixXd A;
+std::string kind = "dense";
+std::size_t d = 8;
+std::string cache;
+sensing A;
 Eigen::VectorXd y;
 Eigen::VectorXd x0;
 Eigen::VectorXd delta;
@@ -44,6 +77,54 @@ double L;
  *  @burn_iters: number of burn-in iterations for samplers.
  *  @dual_iters: number of dual ascent iterations per iteration.
  *
+ *  @accel: acceleration of majorize-minimization x-updates: "none",
+ *   or "grad" or "fn" for nesterov extrapolation with gradient- or
+ *   function-based adaptive restart.
+ *  @aa_depth: memory depth of anderson acceleration of the variational
+ *   fixed-point iterations, or zero to disable it.
+ *
+ *  @xupdate: method of the x-update in irls-ec: "dual" for steps of
+ *   dual ascent, or "cg" for an exact solve of the dual system by
+ *   conjugate gradients.
+ *  @xdraw: method of drawing x in samplers: "chol" for a dense
+ *   cholesky factorization, or "cg" for conjugate gradients.
+ *  @cg_tol: relative residual tolerance of conjugate gradients.
+ *  @cg_iters: maximum number of conjugate gradient iterations.
+ *
+ *  @tol: relative tolerance for early termination, or zero to always
+ *   run all iterations.
+ *  @check_every: number of iterations between convergence checks.
+ *
+ *  @prune_every: number of iterations between full iterations over
+ *   all coordinates, between which the coordinates that have converged
+ *   to zero are dropped from the products, or zero to never drop them.
+ *   not supported by irls-ic, which needs orthonormal rows.
+ *  @prune_tol: magnitude, relative to the largest one, below which a
+ *   coefficient is dropped.
+ *
+ *  @out_mode: result format, set by "out=": "text" for one line per
+ *   element, or "bin" for a binary record including the diagnostics.
+ *  @metrics: whether to replace the estimate output by error metrics
+ *   against the ground truth, written as diagnostics.
+ *  @supp_tol: magnitude above which an estimated coefficient counts
+ *   as part of the recovered support.
+ *
+ *  @chains: number of independent sampler chains.
+ *  @threads: number of threads, or zero for the openmp default.
+ *
+ *  @init_file: path of a state file, set by "init=", from which to
+ *   warm-start the solver, or empty to start cold.
+ *  @save_file: path at which to write the final solver state, set by
+ *   "save=", or empty.
+ *  @warm_burn: length of the windows of draws over which warm-started
+ *   samplers check their split-rhat, to end the burn-in early.
+ *
+ *  @trace_every: number of iterations between trace samples.
+ *  @trace_size: number of trace samples kept, the latest first.
+ *  @trace_file: path of a binary trace file, set by "trace=", or empty
+ *   to write the trace as diagnostics. traces are only recorded by
+ *   solvers compiled with IRLS_TRACE defined.
+ *
  *  @tau: fixed noise precision value.
  *  @xi: fixed regularization parameter value.
  *
@@ -53,29 +134,83 @@ double L;
 std::size_t iters = 1000;
 std::size_t burn_iters = 100;
 std::size_t dual_iters = 5;
+double tol = 0;
+std::size_t check_every = 10;
+std::size_t prune_every = 0;
+double prune_tol = 1e-3;
+std::string accel = "none";
+std::size_t aa_depth = 0;
+std::string xupdate = "dual";
+std::string xdraw = "chol";
+double cg_tol = 1e-6;
+std::size_t cg_iters = 100;
+std::string out_mode = "text";
+bool metrics = false;
+double supp_tol = 0.1;
+std::size_t chains = 1;
+std::size_t threads = 0;
+std::string init_file;
+std::string save_file;
+std::size_t warm_burn = 50;
+std::size_t trace_every = 10;
+std::size_t trace_size = 1024;
+std::string trace_file;
 double tau = 1;
 double xi = 1;
 double beta_tau = 1;
 double beta_xi = 1;
 
+/* inst_parms(): return references to all runtime-settable parameters.
+ */
+static auto inst_parms() {
+  return std::tie(k, m, n, seed, stdev, orth, kind, d, cache, iters,
+                  burn_iters, dual_iters, tol, check_every, prune_every,
+                  prune_tol, accel, aa_depth, xupdate, xdraw, cg_tol,
+                  cg_iters, out_mode, metrics, supp_tol, chains, threads,
+                  init_file, save_file, warm_burn, trace_every, trace_size,
+                  trace_file, tau, xi, beta_tau, beta_xi);
+}
+
+/* inst_reset(): restore all parameters to their values at startup.
+ */
+static void inst_reset() {
+  /* take a snapshot of the parameters on the first call. */
+  static const auto defaults =
+    std::apply([] (auto&... p) { return std::make_tuple(p...); },
+               inst_parms());
+
+  /* restore the snapshot. */
+  inst_parms() = defaults;
+}
+
 /* utility variables:
  *  @pi: ratio of the circumference of a circle to its diameter. ;)
  *  @gen: pseudorandom number generator.
- *  @nrm: standard normal distribution.
- *  @unif: standard uniform distribution.
+ *  @stream_rows: first stream index of the dense sensing matrix rows.
+ *  @stream_noise: stream index of the measurement noise.
+ *
+ * instance streams are indexed above 2^32, away from the streams of
+ * the sampler chains.
  */
 constexpr double pi = 3.14159265358979323846264338327950288;
 std::default_random_engine gen;
-std::normal_distribution<double> nrm{0, 1};
-std::uniform_real_distribution<double> unif{0, 1};
+constexpr std::size_t stream_rows = std::size_t(2) << 32;
+constexpr std::size_t stream_noise = std::size_t(1) << 32;
 
-/* inst_init(): initialize the current problem instance.
+/* result variables, used when writing binary output:
+ *
+ *  @res_x: estimate.
+ *  @res_v: variance of the estimate.
+ *  @res_diag: named diagnostic vectors.
  */
-static void inst_init(int argc, char **argv) {
-  /* parse the runtime arguments. */
-  for (std::size_t i = 1; i < argc; i++) {
-    /* get the current argument. */
-    std::string arg(argv[i]);
+Eigen::VectorXd res_x, res_v;
+std::vector<std::pair<std::string, Eigen::VectorXd>> res_diag;
+
+/* inst_args(): parse a list of key=value runtime arguments.
+ */
+static void inst_args(const std::vector<std::string>& args) {
+  for (const auto& arg : args) {
+    /* locate the separator in the current argument. */
     auto idx = arg.find_first_of('=');
     if (idx == std::string::npos)
       continue;
@@ -91,6 +226,15 @@ static void inst_init(int argc, char **argv) {
           val.compare("true") == 0)
         orth = true;
     }
+    else if (key.compare("metrics") == 0) {
+      if (val.compare("y") == 0 ||
+          val.compare("yes") == 0 ||
+          val.compare("true") == 0)
+        metrics = true;
+    }
+    else if (key.compare("kind") == 0) { kind = val; }
+    else if (key.compare("d") == 0) { d = std::stoi(val); }
+    else if (key.compare("cache") == 0) { cache = val; }
     else if (key.compare("k") == 0) { k = std::stoi(val); }
     else if (key.compare("m") == 0) { m = std::stoi(val); }
     else if (key.compare("n") == 0) { n = std::stoi(val); }
@@ -99,34 +243,428 @@ static void inst_init(int argc, char **argv) {
     else if (key.compare("iters") == 0) { iters = std::stoi(val); }
     else if (key.compare("burn_iters") == 0) { burn_iters = std::stoi(val); }
     else if (key.compare("dual_iters") == 0) { dual_iters = std::stoi(val); }
+    else if (key.compare("tol") == 0) { tol = std::stod(val); }
+    else if (key.compare("check_every") == 0) { check_every = std::stoi(val); }
+    else if (key.compare("prune_every") == 0) { prune_every = std::stoi(val); }
+    else if (key.compare("prune_tol") == 0) { prune_tol = std::stod(val); }
+    else if (key.compare("accel") == 0) { accel = val; }
+    else if (key.compare("aa_depth") == 0) { aa_depth = std::stoi(val); }
+    else if (key.compare("xupdate") == 0) { xupdate = val; }
+    else if (key.compare("xdraw") == 0) { xdraw = val; }
+    else if (key.compare("cg_tol") == 0) { cg_tol = std::stod(val); }
+    else if (key.compare("cg_iters") == 0) { cg_iters = std::stoi(val); }
+    else if (key.compare("out") == 0) { out_mode = val; }
+    else if (key.compare("supp_tol") == 0) { supp_tol = std::stod(val); }
+    else if (key.compare("chains") == 0) { chains = std::stoi(val); }
+    else if (key.compare("threads") == 0) { threads = std::stoi(val); }
+    else if (key.compare("init") == 0) { init_file = val; }
+    else if (key.compare("save") == 0) { save_file = val; }
+    else if (key.compare("warm_burn") == 0) { warm_burn = std::stoi(val); }
+    else if (key.compare("trace_every") == 0) { trace_every = std::stoi(val); }
+    else if (key.compare("trace_size") == 0) { trace_size = std::stoi(val); }
+    else if (key.compare("trace") == 0) { trace_file = val; }
     else if (key.compare("tau") == 0) { tau = std::stod(val); }
     else if (key.compare("xi") == 0)  { xi = std::stod(val); }
     else if (key.compare("beta_tau") == 0) { beta_tau = std::stod(val); }
     else if (key.compare("beta_xi") == 0)  { beta_xi = std::stod(val); }
   }
+}
 
-  /* prepare the required distributions. */
-  std::uniform_int_distribution<std::size_t> idx{0, n - 1};
+/* inst_op(): build the sensing operator of the current problem instance.
+ */
+static void inst_op() {
+  /* prepare the required distribution. */
   std::uniform_int_distribution<std::size_t> bin{0, 1};
-  gen.seed(seed);
 
-  /* compute each row of the measurement matrix. */
-  A.resize(m, n);
-  for (std::size_t i = 0; i < m; i++) {
-    /* sample the row elements. */
-    for (std::size_t j = 0; j < n; j++)
-      A(i,j) = nrm(gen);
+  /* build the operator of the requested kind. */
+  if (kind.compare("dense") == 0) {
+    /* compute each row of the measurement matrix in parallel, each
+     * from its own pseudorandom stream, so the matrix does not depend
+     * on the number of threads.
+     */
+    matrix M{m, n};
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < m; i++) {
+      /* sample the row elements. */
+      Eigen::Map<Eigen::VectorXd> row{M.data() + i * n, Eigen::Index(n)};
+      stream rs{seed, stream_rows + i};
+      rs.normal(row);
 
-    /* normalize the row to unit length. */
-    A.row(i).normalize();
+      /* normalize the row to unit length. */
+      row.normalize();
+    }
+
+    /* if requested, perform complete row-orthonormalization by the
+     * thin householder factor of the transposed matrix.
+     */
+    if (orth) {
+      Eigen::HouseholderQR<Eigen::MatrixXd> qr{M.transpose()};
+      const Eigen::MatrixXd Q =
+        qr.householderQ() * Eigen::MatrixXd::Identity(n, std::min(m, n));
+
+      M = Q.transpose();
+    }
+
+    A.p = std::make_shared<op_dense>(std::move(M));
   }
+  else if (kind.compare("sparse") == 0) {
+    /* orthonormalization is not available, as it would destroy the
+     * sparsity.
+     */
+    if (orth)
+      throw std::invalid_argument("sparse operators cannot be orthonormalized");
+
+    /* scale the entries to match the dense matrix in expectation:
+     * unit-norm rows and squared column norms of m/n.
+     */
+    const std::size_t nnz = std::min(d, m);
+    const double s = std::sqrt(double(m) / (double(nnz) * n));
 
-  /* if requested, perform complete row-orthonormalization. */
-  if (orth) {
-    using SVD = Eigen::JacobiSVD<decltype(A)>;
-    SVD svd(A, Eigen::ComputeThinU | Eigen::ComputeThinV);
-    A = svd.matrixV().transpose();
+    /* place random signs in distinct random rows of each column,
+     * drawn by partial shuffles of a running permutation of the rows.
+     */
+    std::vector<std::size_t> rows(m);
+    for (std::size_t i = 0; i < m; i++)
+      rows[i] = i;
+
+    std::vector<Eigen::Triplet<double>> entries;
+    entries.reserve(nnz * n);
+    for (std::size_t j = 0; j < n; j++) {
+      for (std::size_t i = 0; i < nnz; i++) {
+        std::uniform_int_distribution<std::size_t> sel{i, m - 1};
+        std::swap(rows[i], rows[sel(gen)]);
+        entries.emplace_back(rows[i], j, bin(gen) ? s : -s);
+      }
+    }
+
+    /* build the compressed matrix. */
+    op_sparse::spmatrix M{Eigen::Index(m), Eigen::Index(n)};
+    M.setFromTriplets(entries.begin(), entries.end());
+    A.p = std::make_shared<op_sparse>(std::move(M));
+  }
+  else if (kind.compare("dct") == 0 || kind.compare("dft") == 0) {
+    /* select m distinct rows of the complete transform. */
+    std::vector<std::size_t> rows(n);
+    for (std::size_t i = 0; i < n; i++)
+      rows[i] = i;
+
+    for (std::size_t i = 0; i < m; i++) {
+      std::uniform_int_distribution<std::size_t> sel{i, n - 1};
+      std::swap(rows[i], rows[sel(gen)]);
+    }
+
+    rows.resize(m);
+    std::sort(rows.begin(), rows.end());
+
+    /* the rows of either transform are already orthonormal. */
+    if (kind.compare("dct") == 0)
+      A.p = std::make_shared<op_dct>(n, rows);
+    else
+      A.p = std::make_shared<op_dft>(n, rows);
   }
+  else
+    throw std::invalid_argument("unknown sensing operator '" + kind + "'");
+}
+
+/* inst_header: header of a cached problem instance file.
+ *
+ * the header is followed by the row-major sensing matrix (if dense),
+ * @x0, @y and @delta, all as native doubles. its size keeps the matrix
+ * aligned within the page-aligned file mapping. the version is raised
+ * whenever the generated instances change.
+ */
+struct inst_header {
+  char magic[8];
+  uint64_t version, m, n, dense;
+  double L;
+  uint64_t reserved[2];
+};
+
+constexpr uint64_t inst_version = 1;
+
+/* inst_path(): return the cache file path of the current instance.
+ */
+static std::string inst_path() {
+  std::ostringstream oss;
+  oss << cache << "/" << kind << "-k" << k << "-m" << m << "-n" << n
+      << "-s" << seed << "-e" << std::hexfloat << stdev << std::defaultfloat
+      << "-o" << orth << "-d" << d << ".inst";
+
+  return oss.str();
+}
+
+/* inst_load(): map the current instance from the cache. returns false
+ * if the instance has not been cached.
+ */
+static bool inst_load() {
+  /* map the file and check its header. */
+  const auto map = mapping::open(inst_path());
+  if (!map || map->size() < sizeof(inst_header))
+    return false;
+
+  const bool dense = (kind.compare("dense") == 0);
+  const std::size_t len = (dense ? m * n : 0) + 2 * n + m;
+  const auto *h = reinterpret_cast<const inst_header*>(map->data());
+  if (std::string(h->magic, 8).compare("irlsinst") != 0 ||
+      h->version != inst_version || h->m != m || h->n != n || h->dense != dense ||
+      map->size() != sizeof(inst_header) + len * sizeof(double))
+    return false;
+
+  /* view a dense matrix in place. other operators are cheaply rebuilt. */
+  const double *p = reinterpret_cast<const double*>(h + 1);
+  if (dense) {
+    A.p = std::make_shared<op_dense>(p, m, n, map);
+    p += m * n;
+  }
+  else {
+    gen.seed(seed);
+    inst_op();
+  }
+
+  /* copy the vectors. */
+  x0 = Eigen::Map<const Eigen::VectorXd>(p, n);
+  y = Eigen::Map<const Eigen::VectorXd>(p + n, m);
+  delta = Eigen::Map<const Eigen::VectorXd>(p + n + m, n);
+  L = h->L;
+  return true;
+}
+
+/* inst_save(): write the current instance to the cache.
+ */
+static void inst_save() {
+  /* fill the header. */
+  const auto *Ad = dynamic_cast<const op_dense*>(A.p.get());
+  inst_header h{{'i', 'r', 'l', 's', 'i', 'n', 's', 't'},
+                inst_version, m, n, Ad != nullptr, L, {0, 0}};
+
+  /* write the header and arrays. */
+  mkdir(cache.c_str(), 0755);
+  write_atomic(inst_path(), {{&h, sizeof(h)},
+                             {Ad ? Ad->data() : nullptr,
+                              Ad ? m * n * sizeof(double) : 0},
+                             {x0.data(), n * sizeof(double)},
+                             {y.data(), m * sizeof(double)},
+                             {delta.data(), n * sizeof(double)}});
+}
+
+/* inst_eig(): estimate the dominant eigenvalue of the gramian matrix
+ * by lanczos iterations, stopping once the estimate changes by at most
+ * a relative tolerance @tol.
+ *
+ * only the two latest basis vectors are kept, so memory stays at O(n)
+ * for any problem size. without reorthogonalization, the basis loses
+ * orthogonality as ritz values converge, which only yields spurious
+ * copies of converged eigenvalues and leaves the largest one intact.
+ */
+static double inst_eig(double tol) {
+  /* initialize the basis from the first row of the operator. */
+  const std::size_t kmax = std::min<std::size_t>({m, n, 100});
+  Eigen::VectorXd alpha{kmax}, beta{kmax}, q, qp, w;
+  q = A.transpose() * Eigen::VectorXd::Unit(m, 0);
+  q.normalize();
+  qp.setZero(n);
+
+  /* iterate. */
+  double ev = 0;
+  for (std::size_t j = 0; j < kmax; j++) {
+    /* multiply the newest basis vector by the gramian. */
+    w = A.transpose() * (A * q);
+    alpha(j) = q.dot(w);
+
+    /* orthogonalize against the two latest basis vectors. */
+    w -= alpha(j) * q;
+    if (j > 0)
+      w -= beta(j - 1) * qp;
+
+    beta(j) = w.norm();
+
+    /* compute the largest eigenvalue of the tridiagonal projection. */
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig;
+    eig.computeFromTridiagonal(alpha.head(j + 1), beta.head(j),
+                               Eigen::EigenvaluesOnly);
+
+    /* test for eigenvalue convergence, or an invariant subspace. */
+    const double ev_new = eig.eigenvalues()(j);
+    if (std::abs(ev_new - ev) <= tol * ev_new ||
+        beta(j) <= tol * ev_new)
+      return ev_new;
+
+    /* prepare the next basis vector. */
+    ev = ev_new;
+    qp = q;
+    q = w / beta(j);
+  }
+
+  return ev;
+}
+
+/* state variables:
+ *
+ *  @state_in: named vectors of the initial solver state.
+ *  @state_out: named vectors of the final solver state.
+ *
+ * solvers store their estimate as "x" and their weights as "w", so any
+ * solver may be warm-started from the state of any other. any further
+ * vectors, e.g. the chain states of the samplers, are solver-specific.
+ */
+std::map<std::string, Eigen::VectorXd> state_in, state_out;
+
+/* state_header: header of a solver state file.
+ *
+ * the header is followed by @nvec vectors, each stored as a nul-padded
+ * 16-byte key, a 64-bit element count, and the elements, as in the
+ * diagnostics of binary results.
+ */
+struct state_header {
+  char magic[8];
+  uint64_t n, nvec, reserved;
+};
+
+/* inst_state_load(): read the initial solver state, if any. a missing
+ * or unreadable state file leaves the solver to start cold.
+ */
+static void inst_state_load() {
+  /* map the file and check its header. */
+  state_in.clear();
+  const auto map = init_file.empty() ? nullptr : mapping::open(init_file);
+  if (!map || map->size() < sizeof(state_header))
+    return;
+
+  const auto *h = reinterpret_cast<const state_header*>(map->data());
+  if (std::string(h->magic, 8).compare("irlsstat") != 0)
+    return;
+
+  /* read each vector, stopping at any truncated entry. */
+  std::size_t off = sizeof(state_header);
+  for (uint64_t i = 0; i < h->nvec; i++) {
+    if (off + 24 > map->size())
+      break;
+
+    const char *p = map->data() + off;
+    const uint64_t len = *reinterpret_cast<const uint64_t*>(p + 16);
+    if (off + 24 + 8 * len > map->size())
+      break;
+
+    const std::string key(p, strnlen(p, 16));
+    state_in[key] = Eigen::Map<const Eigen::VectorXd>(
+      reinterpret_cast<const double*>(p + 24), len);
+
+    off += 24 + 8 * len;
+  }
+}
+
+/* inst_state_save(): write the final solver state, if requested.
+ */
+static void inst_state_save() {
+  if (save_file.empty())
+    return;
+
+  /* build the header and the entry keys. */
+  state_header h{{'i', 'r', 'l', 's', 's', 't', 'a', 't'},
+                 n, state_out.size(), 0};
+  std::vector<std::pair<const void*, std::size_t>> bufs{{&h, sizeof(h)}};
+  std::vector<std::array<char, 24>> keys(state_out.size());
+
+  std::size_t i = 0;
+  for (const auto& [key, v] : state_out) {
+    auto& k = keys[i++];
+    k.fill(0);
+    key.copy(k.data(), 15);
+    *reinterpret_cast<uint64_t*>(k.data() + 16) = v.size();
+    bufs.push_back({k.data(), k.size()});
+    bufs.push_back({v.data(), v.size() * sizeof(double)});
+  }
+
+  write_atomic(save_file, bufs);
+}
+
+/* inst_warm(): initialize a vector from the initial state, if it holds
+ * a vector of the same key and size. returns whether it did.
+ */
+static bool inst_warm(const std::string& key, Eigen::Ref<Eigen::VectorXd> v) {
+  const auto it = state_in.find(key);
+  if (it == state_in.end() || it->second.size() != v.size())
+    return false;
+
+  v = it->second;
+  return true;
+}
+
+/* inst_warm(): initialize a scalar from the initial state.
+ */
+static bool inst_warm(const std::string& key, double& v) {
+  Eigen::VectorXd s = Eigen::VectorXd::Constant(1, v);
+  const bool ok = inst_warm(key, s);
+  v = s(0);
+  return ok;
+}
+
+/* inst_warm(): initialize the columns of a matrix, e.g. one per chain
+ * of a sampler, from the initial state: either all at once from the
+ * vector of a matrix key, or each from the vector of a column key.
+ * returns whether it did.
+ */
+static bool inst_warm(const std::string& key, const std::string& col,
+                      Eigen::MatrixXd& M) {
+  Eigen::Map<Eigen::VectorXd> v{M.data(), M.size()};
+  if (inst_warm(key, v))
+    return true;
+
+  Eigen::VectorXd c{M.rows()};
+  if (!inst_warm(col, c))
+    return false;
+
+  M.colwise() = c;
+  return true;
+}
+
+/* inst_keep(): store a vector of the final state.
+ */
+static void inst_keep(const std::string& key,
+                      const Eigen::Ref<const Eigen::VectorXd>& v) {
+  if (!save_file.empty())
+    state_out[key] = v;
+}
+
+/* inst_keep(): store a scalar of the final state.
+ */
+static void inst_keep(const std::string& key, double v) {
+  inst_keep(key, Eigen::VectorXd::Constant(1, v));
+}
+
+/* inst_init(): initialize the current problem instance.
+ */
+static void inst_init(const std::vector<std::string>& args) {
+  /* parse the runtime arguments, and clear any stored results. */
+  inst_args(args);
+  res_x.resize(0);
+  res_v.resize(0);
+  res_diag.clear();
+
+  /* read any initial solver state. */
+  inst_state_load();
+  state_out.clear();
+
+#ifdef _OPENMP
+  /* set up the threads. the default is captured on the first call,
+   * so that a job without a thread count does not inherit the count
+   * of an earlier job in server mode.
+   */
+  static const int default_threads = omp_get_max_threads();
+  omp_set_num_threads(threads > 0 ? int(threads) : default_threads);
+#endif
+
+  /* if available, use the cached instance. */
+  if (!cache.empty() && inst_load())
+    return;
+
+  /* prepare the required distributions. */
+  std::uniform_int_distribution<std::size_t> idx{0, n - 1};
+  std::uniform_int_distribution<std::size_t> bin{0, 1};
+  gen.seed(seed);
+
+  /* build the sensing operator. */
+  inst_op();
 
   /* fill the feature vector with spikes. */
   std::size_t spikes = 0;
@@ -150,38 +688,526 @@ static void inst_init(int argc, char **argv) {
   /* check if the noise is positive. */
   if (stdev > 0) {
     /* add noise to the data vector. */
-    for (std::size_t i = 0; i < m; i++)
-      y(i) += stdev * nrm(gen);
+    Eigen::VectorXd e{m};
+    stream rs{seed, stream_noise};
+    rs.normal(e);
+    y += stdev * e;
   }
 
-  /* compute the dominant eigenvalue of the gramian matrix. */
-  const double tol = 2 * std::numeric_limits<double>::epsilon();
-  Eigen::VectorXd b{n}, Ab{m};
-  b = A.row(0);
-  b.normalize();
-  double ev = 0;
-  while (true) {
-    /* compute a new eigenvector. */
-    Ab = A * b;
-    b = A.transpose() * Ab;
-    b.normalize();
-
-    /* test for eigenvalue convergence. */
-    double ev_new = Ab.dot(Ab) / b.dot(b);
-    if (std::abs(ev - ev_new) <= tol)
-      break;
+  /* compute the dominant eigenvalue of the gramian matrix, and double
+   * the result, yielding the lipschitz constant.
+   */
+  L = 2 * inst_eig(1e-12);
 
-    /* update the eigenvalue estimate. */
-    ev = ev_new;
+  /* compute the diagonal elements of the gramian matrix. */
+  delta = A->colnorms();
+
+  /* if requested, store the instance for later runs. */
+  if (!cache.empty())
+    inst_save();
+}
+
+/* grad(): compute the gradient of the scaled data misfit,
+ *
+ *  g = tau * A' * (A * x - y),
+ *
+ * using the fastest available method of the sensing operator.
+ */
+static void grad(const Eigen::VectorXd& x, double tau, Eigen::VectorXd& g) {
+  g.resize(n);
+  A->grad(x, y, tau, g);
+}
+
+/* active: active-set pruning of the coefficients that have converged
+ * to zero in the deterministic solvers.
+ *
+ * every @prune_every iterations, one iteration runs over all columns.
+ * after it, the coefficients whose magnitude falls below @prune_tol
+ * times the largest one are frozen, and the sensing operator, the data
+ * and the gramian diagonal are replaced by their restrictions to the
+ * remaining (active) columns, so that each product costs O(m * |S|)
+ * until the next full iteration re-admits any coefficient whose full
+ * gradient moves it away from zero. the frozen coefficients are
+ * subtracted from the data, so the residual is unchanged.
+ *
+ * while restricted, the globals @A, @y, @n and @delta describe only
+ * the active columns. solvers iterate over them as usual, but any sum
+ * over all coefficients must add the terms of the frozen ones, which
+ * are available from frozen() and frozen_delta().
+ */
+struct active {
+public:
+  using vectors = std::initializer_list<Eigen::VectorXd*>;
+
+  /* ~active(): restore the full problem, e.g. after an exception.
+   */
+  ~active() { restore(); }
+
+  /* operator(): prepare the coordinates of the next iteration, given
+   * the number of completed iterations and the solver vectors of length
+   * @n, starting with the estimate and the weights. returns whether
+   * their length has changed, in which case any history of the vectors
+   * must be carried over by remap().
+   */
+  bool operator()(std::size_t it, vectors v) {
+    if (prune_every == 0)
+      return false;
+
+    /* run a full iteration at the requested interval, or when asked
+     * to confirm convergence. the first prune waits for one interval,
+     * so that it does not freeze coefficients that have merely started
+     * out small.
+     */
+    if (it % prune_every == 0 || full_next) {
+      full_next = false;
+      pending = (it > 0);
+      return expand(v);
+    }
+
+    /* prune the coefficients once after each full iteration. */
+    if (pending) {
+      pending = false;
+      return compact(v);
+    }
+
+    return false;
   }
 
-  /* double the result, yielding the lipschitz constant. */
-  L = 2 * ev;
+  /* expand(): return the vectors to all columns, with the frozen
+   * coefficients at their values before pruning. returns whether the
+   * vectors were restricted.
+   */
+  bool expand(vectors v) {
+    if (idx.empty())
+      return false;
 
-  /* compute the diagonal elements of the gramian matrix. */
-  delta.resize(n);
-  for (std::size_t i = 0; i < n; i++)
-    delta(i) = A.col(i).squaredNorm();
+    auto f = full.begin();
+    for (auto *p : v) {
+      (*f)(idx) = *p;
+      p->swap(*f++);
+    }
+
+    restore();
+    return true;
+  }
+
+  /* restricted(): return whether the iterations currently run over
+   * the active columns only.
+   */
+  bool restricted() const { return !idx.empty(); }
+
+  /* confirm(): run the next iteration over all columns.
+   */
+  void confirm() { full_next = true; }
+
+  /* remap(): carry a history vector @h of a solver vector across the
+   * latest change of columns, taking the coefficients that it lacks
+   * from the current full solver vector @f.
+   */
+  void remap(Eigen::VectorXd& h, const Eigen::VectorXd& f) const {
+    if (!idx.empty() && std::size_t(h.size()) == n0) {
+      Eigen::VectorXd c = h(idx);
+      h = std::move(c);
+    }
+    else if (idx.empty() && h.size() && std::size_t(h.size()) == prev.size()) {
+      Eigen::VectorXd c = f;
+      c(prev) = h;
+      h = std::move(c);
+    }
+  }
+
+  /* frozen(): return the frozen coefficients of the @i-th solver
+   * vector, or an empty vector if unrestricted.
+   */
+  Eigen::VectorXd frozen(std::size_t i) const {
+    if (idx.empty())
+      return Eigen::VectorXd{};
+
+    return full[i](out);
+  }
+
+  /* frozen_delta(): return the gramian diagonal at the frozen
+   * coefficients, or an empty vector if unrestricted.
+   */
+  Eigen::VectorXd frozen_delta() const {
+    if (idx.empty())
+      return Eigen::VectorXd{};
+
+    return delta0(out);
+  }
+
+private:
+  /* compact(): restrict the problem and the vectors to the active
+   * columns. returns whether any coefficient was pruned.
+   */
+  bool compact(vectors v) {
+    /* select the active columns. */
+    const Eigen::VectorXd& x = **v.begin();
+    const double thr = prune_tol * x.cwiseAbs().maxCoeff();
+    std::vector<std::size_t> keep, drop;
+    for (std::size_t j = 0; j < n; j++)
+      (std::abs(x(j)) > thr ? keep : drop).push_back(j);
+
+    if (keep.empty() || drop.empty())
+      return false;
+
+    /* subtract the frozen coefficients from the data. */
+    Eigen::VectorXd xf = x;
+    xf(keep).setZero();
+    A0 = A;
+    y0 = y;
+    n0 = n;
+    delta0 = delta;
+    y = y0 - A0 * xf;
+
+    /* restrict the problem. */
+    A.p = A0->columns(keep);
+    n = keep.size();
+    delta = delta0(keep);
+
+    /* keep the full vectors, and restrict them. */
+    full.clear();
+    for (auto *p : v) {
+      Eigen::VectorXd c = (*p)(keep);
+      full.push_back(std::move(*p));
+      *p = std::move(c);
+    }
+
+    idx = std::move(keep);
+    out = std::move(drop);
+    return true;
+  }
+
+  /* restore(): return the globals to the full problem.
+   */
+  void restore() {
+    if (idx.empty())
+      return;
+
+    A = std::move(A0);
+    y = std::move(y0);
+    n = n0;
+    delta = std::move(delta0);
+    prev = std::move(idx);
+    idx.clear();
+    out.clear();
+  }
+
+  /* struct members:
+   *
+   *  @pending: whether to prune after the latest full iteration.
+   *  @full_next: whether the next iteration must run over all columns.
+   *  @idx: active columns, or empty if unrestricted.
+   *  @out: frozen columns, or empty if unrestricted.
+   *  @prev: active columns before the latest expansion.
+   *  @full: full vectors, holding the frozen coefficients.
+   *  @A0, @y0, @n0, @delta0: globals of the full problem.
+   */
+  bool pending = false;
+  bool full_next = false;
+  std::vector<std::size_t> idx, out, prev;
+  std::vector<Eigen::VectorXd> full;
+  sensing A0;
+  Eigen::VectorXd y0, delta0;
+  std::size_t n0 = 0;
+};
+
+/* converge: tolerance-based stopping rule for iterative solvers.
+ *
+ * every @check_every iterations, the estimate and the weights are
+ * compared against their values at the previous check, along with the
+ * residual norm. the solver is deemed converged when the relative
+ * changes in all three fall below @tol. weights are compared by their
+ * reciprocals, which remain finite as coefficients vanish. the change
+ * in the residual norm is taken relative to the norm of the full data,
+ * so that a residual that has already vanished counts as converged.
+ */
+struct converge {
+public:
+  /* operator(): return whether the solver should stop after @it
+   * completed iterations.
+   */
+  bool operator()(std::size_t it, const Eigen::VectorXd& x,
+                  const Eigen::VectorXd& w) {
+    /* only check at the requested interval, or to confirm a check. */
+    if (tol <= 0 || (!recheck && it % std::max<std::size_t>(check_every, 1)))
+      return false;
+
+    recheck = false;
+
+    /* compute the residual norm. */
+    const double r = (y - A * x).norm();
+
+    /* compute the relative changes since the last check. */
+    const bool first = (xp.size() == 0);
+    const double dx = first ? 1 : rel(x, xp);
+    const Eigen::VectorXd v = w.cwiseInverse();
+    const double dw = first ? 1 : rel(v, wp);
+    const double dr = first ? 1 : std::abs(r - rp) / std::max(yn, tiny);
+
+    /* store the current values for the next check. */
+    xp = x;
+    wp = v;
+    rp = r;
+
+    return dx <= tol && dw <= tol && dr <= tol;
+  }
+
+  /* operator(): as above, for a solver that prunes its coefficients
+   * by @act. the frozen coefficients cannot move while the iterations
+   * are restricted, so a check that passes then is only accepted once
+   * it passes again right after an iteration over all columns.
+   */
+  bool operator()(std::size_t it, const Eigen::VectorXd& x,
+                  const Eigen::VectorXd& w, active& act) {
+    if (!(*this)(it, x, w))
+      return false;
+
+    if (!act.restricted())
+      return true;
+
+    act.confirm();
+    recheck = true;
+    return false;
+  }
+
+  /* remap(): carry the previous check across a change of the active
+   * columns, given the current estimate and weights.
+   */
+  void remap(const active& act, const Eigen::VectorXd& x,
+             const Eigen::VectorXd& w) {
+    act.remap(xp, x);
+    act.remap(wp, w.cwiseInverse());
+  }
+
+private:
+  /* rel(): relative change between two vectors.
+   */
+  static double rel(const Eigen::VectorXd& a, const Eigen::VectorXd& b) {
+    const double den = std::max(b.norm(), tiny);
+    return (a - b).norm() / den;
+  }
+
+  /* struct members:
+   *
+   *  @tiny: lower bound on the denominators of relative changes.
+   *  @yn: norm of the full data.
+   *  @xp: estimate at the previous check.
+   *  @wp: reciprocal weights at the previous check.
+   *  @rp: residual norm at the previous check.
+   *  @recheck: whether to check after the next iteration.
+   */
+  static constexpr double tiny = 1e-300;
+  double yn = y.norm();
+  Eigen::VectorXd xp, wp;
+  double rp = 0;
+  bool recheck = false;
+};
+
+/* momentum: nesterov (fista) extrapolation of the majorize-minimize
+ * x-updates, with adaptive restart.
+ *
+ * each step is taken from an extrapolated point z instead of from the
+ * current estimate. the momentum is reset whenever the step opposes the
+ * previous one ("grad"), or whenever the step increases the weighted
+ * least-squares objective minimized by the x-update ("fn").
+ */
+struct momentum {
+public:
+  /* momentum(): constructor, takes the acceleration mode.
+   */
+  momentum(const std::string& mode)
+   : grad{mode.compare("grad") == 0}, fn{mode.compare("fn") == 0} {
+    if (!grad && !fn && mode.compare("none") != 0)
+      throw std::invalid_argument("unknown acceleration '" + mode + "'");
+  }
+
+  /* point(): return the point from which to take the next step, given
+   * the current estimate.
+   */
+  const Eigen::VectorXd& point(const Eigen::VectorXd& x) {
+    /* without acceleration, or on the first step, use the estimate. */
+    if (!grad && !fn)
+      return x;
+
+    xk = x;
+    if (xp.size() == 0)
+      return x;
+
+    /* extrapolate along the previous step. */
+    const double t_new = (1 + std::sqrt(1 + 4 * t * t)) / 2;
+    z = x + ((t - 1) / t_new) * (x - xp);
+    t = t_new;
+    return z;
+  }
+
+  /* update(): check the new estimate for a restart.
+   *
+   * arguments:
+   *  @x: new estimate, after the step from point().
+   *  @w: weights used by the step.
+   *  @tau: noise precision used by the step.
+   */
+  void update(const Eigen::VectorXd& x, const Eigen::VectorXd& w, double tau) {
+    if (!grad && !fn)
+      return;
+
+    /* test the restart condition. */
+    bool restart = false;
+    if (grad && z.size())
+      restart = (z - x).dot(x - xk) > 0;
+    else if (fn)
+      restart = objective(x, w, tau) > objective(xk, w, tau);
+
+    if (restart)
+      t = 1;
+
+    xp = xk;
+  }
+
+  /* remap(): carry the momentum across a change of the active columns,
+   * given the current estimate.
+   */
+  void remap(const active& act, const Eigen::VectorXd& x) {
+    act.remap(xk, x);
+    act.remap(xp, x);
+    act.remap(z, x);
+  }
+
+private:
+  /* objective(): weighted least-squares objective of the x-update.
+   */
+  static double objective(const Eigen::VectorXd& x, const Eigen::VectorXd& w,
+                          double tau) {
+    return tau * (A * x - y).squaredNorm() / 2 +
+           w.dot(x.cwiseAbs2()) / 2;
+  }
+
+  /* struct members:
+   *
+   *  @grad: whether to use gradient-based restart.
+   *  @fn: whether to use function-based restart.
+   *  @t: momentum sequence value.
+   *  @xk: estimate at the latest call to point().
+   *  @xp: estimate before the latest step.
+   *  @z: latest extrapolated point.
+   */
+  bool grad, fn;
+  double t = 1;
+  Eigen::VectorXd xk, xp, z;
+};
+
+/* anderson: anderson acceleration of a fixed-point iteration s = G(s).
+ *
+ * the next state is the combination of the latest images G(s) whose
+ * residuals G(s) - s best cancel in the least-squares sense, using the
+ * differences of the last @depth residuals and images. when a residual
+ * grows, the history is discarded and the plain step is taken instead.
+ */
+struct anderson {
+public:
+  /* anderson(): constructor, takes the memory depth.
+   */
+  anderson(std::size_t depth) : depth{depth}, cols{0}, next{0}, fnorm{0} {}
+
+  /* operator(): replace the image @gs of the state @s by the next state.
+   */
+  void operator()(const Eigen::VectorXd& s, Eigen::VectorXd& gs) {
+    if (depth == 0)
+      return;
+
+    /* compute the residual of the plain step. */
+    const Eigen::VectorXd f = gs - s;
+    const double fn = f.norm();
+
+    /* on the first step, allocate the history. */
+    if (fp.size() == 0) {
+      dF.resize(s.size(), depth);
+      dG.resize(s.size(), depth);
+    }
+    else if (fn > fnorm || !std::isfinite(fn)) {
+      /* safeguard: restart from the plain step. */
+      cols = next = 0;
+    }
+    else {
+      /* store the differences in the oldest history slot. */
+      dF.col(next) = f - fp;
+      dG.col(next) = gs - gp;
+      next = (next + 1) % depth;
+      cols = std::min(cols + 1, depth);
+    }
+
+    fp = f;
+    gp = gs;
+    fnorm = fn;
+
+    /* take the plain step without history. */
+    if (cols == 0)
+      return;
+
+    /* combine the images by the least-squares coefficients. */
+    const Eigen::VectorXd c =
+      dF.leftCols(cols).colPivHouseholderQr().solve(f);
+
+    gs -= dG.leftCols(cols) * c;
+  }
+
+private:
+  /* struct members:
+   *
+   *  @depth: maximum number of stored differences.
+   *  @cols: current number of stored differences.
+   *  @next: history slot for the next differences.
+   *  @fnorm: norm of the latest residual.
+   *  @fp, @gp: latest residual and image.
+   *  @dF, @dG: residual and image differences.
+   */
+  std::size_t depth, cols, next;
+  double fnorm;
+  Eigen::VectorXd fp, gp;
+  Eigen::MatrixXd dF, dG;
+};
+
+/* pcg(): solve a symmetric positive definite linear system Q * x = b
+ * by preconditioned conjugate gradients, starting from the current
+ * contents of @x. returns the number of iterations performed.
+ *
+ * arguments:
+ *  @Q: function computing the product of the system matrix with a vector.
+ *  @P: diagonal of the inverse of the (jacobi) preconditioner.
+ *  @b: right-hand side vector.
+ *  @x: initial guess, overwritten by the solution.
+ *  @tol: tolerance on the residual norm, relative to that of @b.
+ *  @maxit: maximum number of iterations.
+ */
+template<typename F>
+static std::size_t pcg(F&& Q, const Eigen::VectorXd& P,
+                       const Eigen::VectorXd& b, Eigen::VectorXd& x,
+                       double tol, std::size_t maxit) {
+  /* compute the initial residual and search direction. */
+  Eigen::VectorXd r = b - Q(x);
+  Eigen::VectorXd z = P.cwiseProduct(r);
+  Eigen::VectorXd p = z, Qp;
+  double rz = r.dot(z);
+
+  /* iterate until the residual is small enough. */
+  const double bound = tol * b.norm();
+  std::size_t it = 0;
+  for (; it < maxit && r.norm() > bound; it++) {
+    /* step along the search direction. */
+    Qp = Q(p);
+    const double alpha = rz / p.dot(Qp);
+    x += alpha * p;
+    r -= alpha * Qp;
+
+    /* compute the next conjugate search direction. */
+    z = P.cwiseProduct(r);
+    const double rz_new = r.dot(z);
+    p = z + (rz_new / rz) * p;
+    rz = rz_new;
+  }
+
+  return it;
 }
 
 /* igrnd(): draw a random sample from an inverse Gaussian distribution.
@@ -189,11 +1215,12 @@ static void inst_init(int argc, char **argv) {
  * arguments:
  *  @mu: mean parameter.
  *  @lambda: shape parameter.
+ *  @rs: pseudorandom stream to draw from.
  */
-static double igrnd(double mu, double lambda) {
+static double igrnd(double mu, double lambda, stream& rs) {
   /* draw a standard normal variate and a standard uniform variate. */
-  const double z = nrm(gen);
-  const double u = unif(gen);
+  const double z = rs.normal();
+  const double u = rs.uniform();
 
   /* square the normal variate. */
   const double y = std::pow(z, 2);
@@ -211,3 +1238,566 @@ static double igrnd(double mu, double lambda) {
   return (u <= mu / (mu + x1) ? x1 : x2);
 }
 
+/* igrnd(): fill a vector with random samples from inverse Gaussian
+ * distributions, using batched and vectorized variate generation.
+ *
+ * arguments:
+ *  @mu: mean parameters.
+ *  @lambda: shape parameters.
+ *  @x: output vector of samples.
+ *  @rs: pseudorandom stream to draw from.
+ */
+static void igrnd(const Eigen::ArrayXd& mu, const Eigen::ArrayXd& lambda,
+                  Eigen::Ref<Eigen::VectorXd> x, stream& rs) {
+  /* draw vectors of standard normal and standard uniform variates. */
+  Eigen::VectorXd z{x.size()}, u{x.size()};
+  rs.normal(z);
+  rs.uniform(u);
+
+  /* square the normal variates. */
+  const Eigen::ArrayXd y = z.array().square();
+
+  /* compute intermediate quantities. */
+  const Eigen::ArrayXd B = mu / (2 * lambda);
+  const Eigen::ArrayXd A = mu * y * B;
+  const Eigen::ArrayXd C = 4 * mu * lambda * y + mu * mu * y * y;
+
+  /* compute the two roots to the associated quadratic functions. */
+  const Eigen::ArrayXd x1 = mu + A - B * C.sqrt();
+  const Eigen::ArrayXd x2 = mu * mu / x1;
+
+  /* select one of the roots, based on the uniform deviates. */
+  x = (u.array() <= mu / (mu + x1)).select(x1, x2).matrix();
+}
+
+/* chain_stats: running moments of the samples drawn by one or more
+ * chains. each chain is split into two halves, whose moments are
+ * kept separately for computing the split-rhat diagnostic.
+ */
+struct chain_stats {
+public:
+  /* chain_stats(): constructor, takes the sample dimension, the number
+   * of chains, and the number of samples to be drawn per chain.
+   */
+  chain_stats(std::size_t dim, std::size_t num, std::size_t draws)
+   : S{draws}, cnt(2 * num, 0),
+     mu{Eigen::MatrixXd::Zero(dim, 2 * num)},
+     M2{Eigen::MatrixXd::Zero(dim, 2 * num)} {}
+
+  /* update(): add the @s-th sample of chain @c. updates of distinct
+   * chains may be run concurrently.
+   */
+  void update(std::size_t c, std::size_t s, const Eigen::VectorXd& x) {
+    /* determine the chain half and its sample count. */
+    const std::size_t h = 2 * c + (2 * s >= S);
+    const double N = ++cnt[h];
+
+    /* update the first and second moments. */
+    const Eigen::VectorXd M1 = x - mu.col(h);
+    mu.col(h) += M1 / N;
+    M2.col(h) += M1.cwiseProduct(x - mu.col(h));
+  }
+
+  /* pooled(): compute the mean and variance over all samples.
+   */
+  void pooled(Eigen::VectorXd& mean, Eigen::VectorXd& var) const {
+    /* compute the pooled mean. */
+    double N = 0;
+    mean.setZero(mu.rows());
+    for (std::size_t h = 0; h < cnt.size(); h++) {
+      mean += cnt[h] * mu.col(h);
+      N += cnt[h];
+    }
+
+    mean /= std::max(N, 1.);
+
+    /* combine the within-half and between-half sums of squares. */
+    var.setZero(mu.rows());
+    for (std::size_t h = 0; h < cnt.size(); h++)
+      var += M2.col(h) + cnt[h] * (mu.col(h) - mean).cwiseAbs2();
+
+    var /= std::max(N, 1.);
+  }
+
+  /* rhat(): compute the split-rhat potential scale reduction factor
+   * of each sample element.
+   */
+  Eigen::VectorXd rhat() const {
+    /* use the smallest half length as the common length. */
+    const double N = *std::min_element(cnt.begin(), cnt.end());
+    const double H = cnt.size();
+
+    /* compute the mean within-half variance. */
+    Eigen::VectorXd W = Eigen::VectorXd::Zero(mu.rows());
+    for (std::size_t h = 0; h < cnt.size(); h++)
+      W += M2.col(h) / (cnt[h] - 1);
+
+    W /= H;
+
+    /* compute the between-half variance of the means. */
+    const Eigen::VectorXd mean = mu.rowwise().mean();
+    const Eigen::VectorXd B =
+      (mu.colwise() - mean).cwiseAbs2().rowwise().sum() / (H - 1);
+
+    /* compute the ratio of the pooled and within-half variances. */
+    const Eigen::VectorXd V = ((N - 1) / N) * W + B;
+    return V.cwiseQuotient(W).cwiseSqrt();
+  }
+
+private:
+  /* struct members:
+   *
+   *  @S: number of samples per chain.
+   *  @cnt: number of samples in each chain half.
+   *  @mu: mean of each chain half.
+   *  @M2: sum of squared deviations of each chain half.
+   */
+  std::size_t S;
+  std::vector<std::size_t> cnt;
+  Eigen::MatrixXd mu, M2;
+};
+
+/* burnin: burn-in length of the samplers.
+ *
+ * cold chains always run all @burn_iters burn-in iterations. warm chains
+ * start from the state at another problem, which may be far from the
+ * new posterior, so they are only cut short once the split-rhat of every
+ * element over a window of @warm_burn draws falls below @tol.
+ */
+struct burnin {
+public:
+  /* burnin(): constructor, takes whether the chains were warm-started.
+   */
+  burnin(bool warm)
+   : len{burn_iters}, warm{warm && warm_burn >= 4 && warm_burn < burn_iters},
+     probe{n, chains, warm_burn} {}
+
+  /* update(): check the draws @X of all chains after iteration @it
+   * of the burn-in.
+   */
+  void update(std::size_t it, const Eigen::MatrixXd& X) {
+    if (!warm || it >= len)
+      return;
+
+    for (std::size_t c = 0; c < chains; c++)
+      probe.update(c, it % warm_burn, X.col(c));
+
+    if ((it + 1) % warm_burn)
+      return;
+
+    /* end the burn-in once mixed, or start a new window. undefined
+     * values of the diagnostic count as unmixed.
+     */
+    if ((probe.rhat().array() <= tol).all())
+      len = it + 1;
+    else
+      probe = chain_stats{n, chains, warm_burn};
+  }
+
+  /* struct members:
+   *
+   *  @tol: split-rhat below which the chains count as mixed.
+   *  @len: current burn-in length.
+   *  @warm: whether the burn-in may be cut short.
+   *  @probe: moments of the current window of draws.
+   */
+  static constexpr double tol = 1.1;
+  std::size_t len;
+  bool warm;
+  chain_stats probe;
+};
+
+/* res_header: header of a binary result.
+ *
+ * the header is followed by the estimate and its variance, both of
+ * @n doubles, and then by @ndiag diagnostics. each diagnostic is a
+ * nul-padded 16-byte key, a 64-bit element count, and the elements.
+ * all fields are little-endian and 8-byte aligned.
+ */
+struct res_header {
+  char magic[8];
+  uint64_t n, ndiag, reserved;
+};
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "binary results are only written on little-endian hosts"
+#endif
+
+/* inst_flush(): write the stored results as a binary record.
+ */
+static void inst_flush(std::ostream& out) {
+  if (out_mode.compare("bin") != 0)
+    return;
+
+  /* write the header, estimate and variance. */
+  res_header h{{'i', 'r', 'l', 's', 'r', 'e', 's', '\0'},
+               uint64_t(res_x.size()), res_diag.size(), 0};
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  out.write(reinterpret_cast<const char*>(res_x.data()),
+            res_x.size() * sizeof(double));
+  out.write(reinterpret_cast<const char*>(res_v.data()),
+            res_v.size() * sizeof(double));
+
+  /* write the diagnostics. */
+  for (const auto& [key, v] : res_diag) {
+    char name[16] = {0};
+    const uint64_t len = v.size();
+    key.copy(name, sizeof(name) - 1);
+    out.write(name, sizeof(name));
+    out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+    out.write(reinterpret_cast<const char*>(v.data()), len * sizeof(double));
+  }
+
+  out.flush();
+}
+
+/* inst_diag(): write a named diagnostic vector as one line of text,
+ * or store it for binary output.
+ */
+static void inst_diag(std::ostream& err, const std::string& key,
+                      const Eigen::VectorXd& v) {
+  if (out_mode.compare("bin") == 0) {
+    res_diag.emplace_back(key, v);
+    return;
+  }
+
+  err << key;
+  for (Eigen::Index i = 0; i < v.size(); i++)
+    err << " " << v(i);
+
+  err << "\n";
+}
+
+/* inst_diag(): write a named scalar diagnostic as one line of text.
+ */
+static void inst_diag(std::ostream& err, const std::string& key, double v) {
+  inst_diag(err, key, Eigen::VectorXd::Constant(1, v));
+}
+
+/* inst_metrics(): write error metrics of an estimate as diagnostics:
+ * its normalized mean squared error against the ground truth, the
+ * precision and recall of its support, and its residual norm.
+ */
+static void inst_metrics(std::ostream& err, const Eigen::VectorXd& x) {
+  /* compare the estimated support against the true support. */
+  std::size_t hits = 0, found = 0, total = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    const bool est = std::abs(x(i)) > supp_tol, tru = x0(i) != 0;
+    hits += est && tru;
+    found += est;
+    total += tru;
+  }
+
+  inst_diag(err, "nmse", (x - x0).squaredNorm() / x0.squaredNorm());
+  inst_diag(err, "precision", found ? double(hits) / found : 1);
+  inst_diag(err, "recall", total ? double(hits) / total : 1);
+  inst_diag(err, "resid", (y - A * x).norm());
+}
+
+/* inst_output(): write the estimate and its variance, as one line of
+ * text per element, or store them for binary output. if requested,
+ * only error metrics are written instead.
+ */
+static void inst_output(std::ostream& out, std::ostream& err,
+                        const Eigen::VectorXd& x, const Eigen::VectorXd& v) {
+  if (metrics) {
+    inst_metrics(err, x);
+    return;
+  }
+
+  if (out_mode.compare("bin") == 0) {
+    res_x = x;
+    res_v = v;
+    return;
+  }
+
+  for (Eigen::Index i = 0; i < x.size(); i++)
+    out << x(i) << " " << v(i) << "\n";
+}
+
+/* inst_output(): write an estimate with zero variance.
+ */
+static void inst_output(std::ostream& out, std::ostream& err,
+                        const Eigen::VectorXd& x) {
+  inst_output(out, err, x, Eigen::VectorXd::Zero(x.size()));
+}
+
+#ifdef IRLS_TRACE
+/* trace variables:
+ *
+ *  @trace: samples of the current run.
+ *  @trace_xp: estimate before the next sampled iteration.
+ */
+trace_buffer trace;
+Eigen::VectorXd trace_xp;
+
+/* trace_header: header of a binary trace file.
+ *
+ * the header is followed by the nul-padded 16-byte names of the
+ * @nfield fields, and then by @count samples of @nfield doubles each.
+ */
+struct trace_header {
+  char magic[8];
+  uint64_t nfield, count, reserved;
+};
+
+/* inst_trace(): sample an iteration, given the number of completed
+ * iterations, the estimate, the weights and the noise precision. the
+ * objective is the weighted least-squares objective of the x-update,
+ *
+ *  prec/2 * |y - A * x|^2 + 1/2 * x' * diag(w) * x,
+ *
+ * and the step is the change in the estimate over the iteration.
+ */
+static void inst_trace(std::size_t it, const Eigen::Ref<const Eigen::VectorXd>& x,
+                       const Eigen::Ref<const Eigen::VectorXd>& w, double prec) {
+  if (trace_every == 0)
+    return;
+
+  /* exclude the sampling time from the phases. */
+  trace.pause();
+
+  /* sample the iteration. */
+  if (it % trace_every == 0) {
+    const double r2 = (y - A * x).squaredNorm();
+    const double wx = (x.array() == 0).select(0, w.array() * x.array().abs2()).sum();
+    trace_record rec{};
+    rec[trace_it] = it;
+    rec[trace_obj] = (prec * r2 + wx) / 2;
+    rec[trace_resid] = std::sqrt(r2);
+    rec[trace_wmin] = w.minCoeff();
+    rec[trace_wmax] = w.maxCoeff();
+    rec[trace_step] = trace_xp.size() == x.size() ?
+                      (x - trace_xp).norm() : NAN;
+    trace.record(rec);
+  }
+
+  /* keep the estimate preceding the next sampled iteration. */
+  if ((it + 1) % trace_every == 0)
+    trace_xp = x;
+
+  trace.resume();
+}
+
+/* inst_trace_reset(): clear the trace before a run.
+ */
+static void inst_trace_reset() {
+  trace.reset(trace_size);
+  trace_xp.resize(0);
+}
+
+/* inst_trace_flush(): write the trace after a run, either as one
+ * diagnostic per field or into a binary file.
+ */
+static void inst_trace_flush(std::ostream& err) {
+  if (trace.size() == 0)
+    return;
+
+  /* write the diagnostics. */
+  if (trace_file.empty()) {
+    for (int f = 0; f < trace_nfield; f++) {
+      const std::vector<double> v = trace.column(f);
+      inst_diag(err, std::string("trace_") + trace_names[f],
+                Eigen::Map<const Eigen::VectorXd>(v.data(), v.size()));
+    }
+
+    return;
+  }
+
+  /* or, write the binary file. */
+  trace_header h{{'i', 'r', 'l', 's', 't', 'r', 'c', '\0'},
+                 trace_nfield, trace.size(), 0};
+  char names[trace_nfield][16] = {};
+  for (int f = 0; f < trace_nfield; f++)
+    std::string(trace_names[f]).copy(names[f], 15);
+
+  const std::vector<trace_record> recs = trace.records();
+  write_atomic(trace_file, {{&h, sizeof(h)}, {names, sizeof(names)},
+                            {recs.data(), recs.size() * sizeof(trace_record)}});
+}
+
+/* tracing hooks, which mark the phases and iterations of the solvers
+ * and compile to nothing unless IRLS_TRACE is defined.
+ */
+#define TRACE_PHASE(p) trace.phase(trace_##p)
+#define TRACE_ITER(it, x, w, prec) inst_trace(it, x, w, prec)
+#define TRACE_RESET() inst_trace_reset()
+#define TRACE_FLUSH(err) inst_trace_flush(err)
+#else
+#define TRACE_PHASE(p)
+#define TRACE_ITER(it, x, w, prec)
+#define TRACE_RESET()
+#define TRACE_FLUSH(err)
+#endif
+
+/* solver: function type implemented by each solver binary.
+ *
+ * arguments:
+ *  @out: stream for the estimate output.
+ *  @err: stream for any diagnostic output.
+ */
+using solver = void (*)(std::ostream& out, std::ostream& err);
+
+/* inst_job(): run a solver on one problem instance, given as a line
+ * of whitespace-separated key=value arguments, and write a framed
+ * result record to a file.
+ *
+ * the record is a header line holding the byte counts of the
+ * solver output and diagnostics, followed by the bytes themselves.
+ */
+static void inst_job(const std::string& line, FILE *fout, solver solve) {
+  /* split the line into arguments. */
+  std::vector<std::string> args;
+  std::istringstream iss(line);
+  for (std::string arg; iss >> arg;)
+    args.push_back(arg);
+
+  /* initialize the instance and run the solver into buffers. */
+  std::ostringstream out, err;
+  try {
+    inst_reset();
+    inst_init(args);
+    TRACE_RESET();
+    solve(out, err);
+    TRACE_FLUSH(err);
+    inst_state_save();
+    inst_flush(out);
+  }
+  catch (const std::exception& e) {
+    out.str("");
+    err << "error " << e.what() << "\n";
+  }
+
+  /* write the framed result record. */
+  const std::string sout = out.str();
+  const std::string serr = err.str();
+  std::fprintf(fout, "%zu %zu\n", sout.size(), serr.size());
+  std::fwrite(sout.data(), 1, sout.size(), fout);
+  std::fwrite(serr.data(), 1, serr.size(), fout);
+  std::fflush(fout);
+}
+
+/* inst_serve(): read job lines from a file until end-of-file, writing
+ * one result record per job.
+ */
+static void inst_serve(FILE *fin, FILE *fout, solver solve) {
+  char *buf = nullptr;
+  std::size_t len = 0;
+  while (getline(&buf, &len, fin) != -1) {
+    /* skip blank lines. */
+    const std::string line(buf);
+    if (line.find_first_not_of(" \t\r\n") == std::string::npos)
+      continue;
+
+    inst_job(line, fout, solve);
+  }
+
+  std::free(buf);
+}
+
+/* inst_listen(): accept connections on a unix domain socket, serving
+ * the jobs of each connection in turn.
+ */
+static int inst_listen(const std::string& path, solver solve) {
+  /* create the socket. */
+  sockaddr_un addr{};
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "error: unable to create socket '" << path << "'\n";
+    return 1;
+  }
+
+  /* bind the socket to the filesystem path. */
+  addr.sun_family = AF_UNIX;
+  path.copy(addr.sun_path, path.size());
+  unlink(path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(fd, 16) < 0) {
+    std::cerr << "error: unable to bind socket '" << path << "'\n";
+    return 1;
+  }
+
+  /* clients that disconnect early are detected by their streams. */
+  signal(SIGPIPE, SIG_IGN);
+
+  /* serve connections until killed. */
+  while (true) {
+    const int cfd = accept(fd, nullptr, nullptr);
+    if (cfd < 0)
+      continue;
+
+    /* use separate streams for reading and writing. */
+    FILE *fin = fdopen(cfd, "r");
+    if (!fin) {
+      close(cfd);
+      continue;
+    }
+
+    const int ofd = dup(cfd);
+    FILE *fout = (ofd < 0 ? nullptr : fdopen(ofd, "w"));
+    if (!fout) {
+      if (ofd >= 0)
+        close(ofd);
+
+      std::fclose(fin);
+      continue;
+    }
+
+    inst_serve(fin, fout, solve);
+    std::fclose(fout);
+    std::fclose(fin);
+  }
+}
+
+/* inst_main(): common entry point of all solvers.
+ *
+ * by default, a single instance is built from the command line and
+ * solved, with output to stdout and stderr. if "serve=-" is passed,
+ * the process instead stays resident and reads one job per line of
+ * stdin, where each line holds the same key=value arguments as the
+ * command line. "serve=<path>" does the same over a unix socket.
+ * in either server mode, any other command-line arguments become the
+ * defaults for every job.
+ */
+static int inst_main(int argc, char **argv, solver solve) {
+  /* gather the arguments and check for server mode. */
+  std::string serve;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg.compare(0, 6, "serve=") == 0)
+      serve = arg.substr(6);
+    else
+      args.push_back(arg);
+  }
+
+  /* in server mode, snapshot the job defaults. */
+  if (!serve.empty()) {
+    inst_args(args);
+    inst_reset();
+  }
+
+  /* run in server mode, if requested. */
+  if (serve.compare("-") == 0) {
+    inst_serve(stdin, stdout, solve);
+    return 0;
+  }
+  else if (!serve.empty())
+    return inst_listen(serve, solve);
+
+  /* otherwise, solve a single instance. */
+  try {
+    inst_init(args);
+    TRACE_RESET();
+    solve(std::cout, std::cerr);
+    TRACE_FLUSH(std::cerr);
+    inst_state_save();
+    inst_flush(std::cout);
+  }
+  catch (const std::exception& e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
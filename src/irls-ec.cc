@@ -3,10 +3,9 @@
  * Released under the MIT License.
  */
 
-int main(int argc, char **argv) {
-  /* initialize the problem instance. */
-  inst_init(argc, argv);
-
+/* solve(): run the solver on the current problem instance.
+ */
+static void solve(std::ostream& out, std::ostream& err) {
   /* initialize the estimate. */
   Eigen::VectorXd x;
   x.resize(n);
@@ -22,24 +21,96 @@ int main(int argc, char **argv) {
   lambda.resize(m);
   lambda.setZero();
 
-  /* iterate. */
-  for (std::size_t it = 0; it < iters; it++) {
-    /* dual ascent iterations. */
-    const double kappa = w.minCoeff();
-    for (std::size_t jt = 0; jt < dual_iters; jt++) {
-      /* update the lagrange multipliers. */
-      lambda += kappa * (y - A * x);
+  /* if available, warm-start from a prior state. */
+  inst_warm("x", x);
+  inst_warm("w", w);
+  inst_warm("lambda", lambda);
+
+  /* iterate until converged. */
+  std::size_t cg_total = 0;
+  converge conv;
+  active act;
+  std::size_t it = 0;
+  while (it < iters) {
+    /* restrict the iteration to the active coefficients. */
+    TRACE_PHASE(aux);
+    if (act(it, {&x, &w}))
+      conv.remap(act, x, w);
+
+    TRACE_PHASE(x);
+    if (xupdate.compare("cg") == 0 && n >= m) {
+      /* solve (A * inv(W) * A') * lambda = y for the exact lagrange
+       * multipliers by conjugate gradients, starting from the previous
+       * multipliers, with a jacobi preconditioner.
+       */
+      const Eigen::VectorXd winv = w.cwiseInverse();
+      auto Q = [&winv] (const Eigen::VectorXd& v) -> Eigen::VectorXd {
+        return A * (A.transpose() * v).cwiseProduct(winv);
+      };
+      cg_total += pcg(Q, A->rownorms(winv).cwiseInverse(), y, lambda,
+                      cg_tol, cg_iters);
 
       /* update the estimate from the lagrange multipliers. */
-      x = (A.transpose() * lambda).cwiseQuotient(w);
+      x = (A.transpose() * lambda).cwiseProduct(winv);
+    }
+    else if (xupdate.compare("cg") == 0) {
+      /* once fewer than m columns remain active, the multiplier system
+       * is singular and the constraints can no longer be met exactly.
+       * instead, solve (A' * A + mu * W) * x = A' * y for the weighted
+       * least-squares fit over the active columns, the limit of the
+       * constrained solution as the constraints become penalties.
+       */
+      const double mu = 1e-6;
+      auto Q = [&w, mu] (const Eigen::VectorXd& v) -> Eigen::VectorXd {
+        return A.transpose() * (A * v) + mu * w.cwiseProduct(v);
+      };
+      const Eigen::VectorXd b = A.transpose() * y;
+      cg_total += pcg(Q, (delta + mu * w).cwiseInverse(), b, x,
+                      cg_tol, cg_iters);
+    }
+    else {
+      /* or, dual ascent iterations. */
+      const double kappa = w.minCoeff();
+      for (std::size_t jt = 0; jt < dual_iters; jt++) {
+        /* update the lagrange multipliers. */
+        lambda += kappa * (y - A * x);
+
+        /* update the estimate from the lagrange multipliers. */
+        x = (A.transpose() * lambda).cwiseQuotient(w);
+      }
     }
 
     /* update the weights. */
+    TRACE_PHASE(w);
     w = (x.array().abs2() + 1e-6).sqrt().inverse();
+
+    /* check for convergence. */
+    TRACE_ITER(it + 1, x, w, tau);
+    TRACE_PHASE(check);
+    if (conv(++it, x, w, act))
+      break;
   }
 
+  /* return to all coefficients. */
+  act.expand({&x, &w});
+
+  /* store the final state. */
+  inst_keep("x", x);
+  inst_keep("w", w);
+  inst_keep("lambda", lambda);
+
   /* output the final estimate with zero variance. */
-  for (std::size_t i = 0; i < n; i++)
-    std::cout << x(i) << " " << 0 << "\n";
+  inst_output(out, err, x);
+
+  /* output the number of iterations used. */
+  inst_diag(err, "iters", it);
+
+  /* output the number of conjugate gradient iterations used. */
+  if (xupdate.compare("cg") == 0)
+    inst_diag(err, "cg_iters", cg_total);
 }
 
+int main(int argc, char **argv) {
+  /* solve the problem instance. */
+  return inst_main(argc, argv, solve);
+}
@@ -3,19 +3,18 @@
  * Released under the MIT License.
  */
 
-int main(int argc, char **argv) {
-  /* initialize the problem instance. */
-  inst_init(argc, argv);
-
+/* solve(): run the solver on the current problem instance.
+ */
+static void solve(std::ostream& out, std::ostream& err) {
   /* initialize the estimate. */
   Eigen::VectorXd x;
   x.resize(n);
   x.setZero();
 
-  /* initialize an auxiliary variable. */
-  Eigen::VectorXd z;
-  z.resize(n);
-  z.setZero();
+  /* initialize the gradient of the data misfit. */
+  Eigen::VectorXd g;
+  g.resize(n);
+  g.setZero();
 
   /* initialize the weights. */
   Eigen::VectorXd w;
@@ -25,19 +24,58 @@ int main(int argc, char **argv) {
   /* precompute a scale factor for the x-update. */
   const double Lt2 = L * tau / 2;
 
-  /* iterate. */
-  for (std::size_t it = 0; it < iters; it++) {
+  /* if available, warm-start from a prior estimate. the prior weights
+   * are not used, as they are infinite at every zero coefficient and
+   * would pin it to zero.
+   */
+  inst_warm("x", x);
+
+  /* iterate until converged, optionally with momentum. */
+  momentum acc{accel};
+  converge conv;
+  active act;
+  std::size_t it = 0;
+  while (it < iters) {
+    /* restrict the iteration to the active coefficients. */
+    TRACE_PHASE(aux);
+    if (act(it, {&x, &w})) {
+      acc.remap(act, x);
+      conv.remap(act, x, w);
+    }
+
     /* update the estimate. */
-    z = x;
-    x = (Lt2 * z - tau * A.transpose() * (A * z - y)).array()
-      / (Lt2 + w.array());
+    TRACE_PHASE(x);
+    const Eigen::VectorXd& p = acc.point(x);
+    grad(p, tau, g);
+    x = (Lt2 * p - g).array() / (Lt2 + w.array());
+    acc.update(x, w, tau);
 
     /* update the weights. */
+    TRACE_PHASE(w);
     w = (xi * x.array().abs2().inverse()).sqrt();
+
+    /* check for convergence. */
+    TRACE_ITER(it + 1, x, w, tau);
+    TRACE_PHASE(check);
+    if (conv(++it, x, w, act))
+      break;
   }
 
+  /* return to all coefficients. */
+  act.expand({&x, &w});
+
+  /* store the final state. */
+  inst_keep("x", x);
+  inst_keep("w", w);
+
   /* output the final estimate with zero variance. */
-  for (std::size_t i = 0; i < n; i++)
-    std::cout << x(i) << " " << 0 << "\n";
+  inst_output(out, err, x);
+
+  /* output the number of iterations used. */
+  inst_diag(err, "iters", it);
 }
 
+int main(int argc, char **argv) {
+  /* solve the problem instance. */
+  return inst_main(argc, argv, solve);
+}
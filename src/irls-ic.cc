@@ -3,10 +3,14 @@
  * Released under the MIT License.
  */
 
-int main(int argc, char **argv) {
-  /* initialize the problem instance, with orthonormalization. */
-  orth = true;
-  inst_init(argc, argv);
+/* solve(): run the solver on the current problem instance.
+ */
+static void solve(std::ostream& out, std::ostream& err) {
+  /* the estimate update relies on orthonormal rows of the sensing
+   * operator, which do not survive a restriction of its columns.
+   */
+  if (prune_every)
+    throw std::invalid_argument("irls-ic does not support pruning");
 
   /* initialize the estimate. */
   Eigen::VectorXd x;
@@ -31,9 +35,16 @@ int main(int argc, char **argv) {
   /* precompute the constraint bound from the noise precision. */
   const double c = std::sqrt(m / tau);
 
-  /* iterate. */
-  for (std::size_t it = 0; it < iters; it++) {
+  /* if available, warm-start from a prior state. */
+  inst_warm("x", x);
+  inst_warm("w", w);
+
+  /* iterate until converged. */
+  converge conv;
+  std::size_t it = 0;
+  while (it < iters) {
     /* compute the Lipschitz constant for the bounded function. */
+    TRACE_PHASE(aux);
     const double Lw = 2 * w.maxCoeff();
 
     /* compute the Lagrange multiplier. */
@@ -43,15 +54,34 @@ int main(int argc, char **argv) {
     const double beta = (4 * lambda) / (4 * lambda + Lw);
 
     /* update the estimate. */
-    z = (Lw/2) * x - w.cwiseProduct(x) + 2 * lambda * A.transpose() * y;
-    x = (2/Lw) * (z - beta * A.transpose() * A * z);
+    TRACE_PHASE(x);
+    z = (Lw/2) * x - w.cwiseProduct(x) + 2 * lambda * (A.transpose() * y);
+    x = (2/Lw) * (z - beta * (A.transpose() * (A * z)));
 
     /* update the weights. */
+    TRACE_PHASE(w);
     w = (x.array().abs2() + 1e-6).sqrt().inverse();
+
+    /* check for convergence. */
+    TRACE_ITER(it + 1, x, w, tau);
+    TRACE_PHASE(check);
+    if (conv(++it, x, w))
+      break;
   }
 
+  /* store the final state. */
+  inst_keep("x", x);
+  inst_keep("w", w);
+
   /* output the final estimate with zero variance. */
-  for (std::size_t i = 0; i < n; i++)
-    std::cout << x(i) << " " << 0 << "\n";
+  inst_output(out, err, x);
+
+  /* output the number of iterations used. */
+  inst_diag(err, "iters", it);
 }
 
+int main(int argc, char **argv) {
+  /* solve the problem instance, with orthonormalization. */
+  orth = true;
+  return inst_main(argc, argv, solve);
+}
@@ -0,0 +1,700 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "fft.hh"
+
+/* type definitions:
+ *
+ *  @matrix: dense matrix type used for the sensing matrix. rows are
+ *   stored contiguously, so that row panels may be swept in cache.
+ *  @vec: read-only reference to a vector argument.
+ *  @vecref: writable reference to a vector result.
+ */
+using matrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                             Eigen::RowMajor>;
+using vec = Eigen::Ref<const Eigen::VectorXd>;
+using vecref = Eigen::Ref<Eigen::VectorXd>;
+
+/* op: abstract linear sensing operator, mapping n-vectors to m-vectors.
+ */
+struct op : public std::enable_shared_from_this<op> {
+public:
+  /* op(): constructor, takes the operator dimensions.
+   */
+  op(std::size_t rows, std::size_t cols) : m{rows}, n{cols} {}
+  virtual ~op() = default;
+
+  /* rows(), cols(): return the operator dimensions.
+   */
+  std::size_t rows() const { return m; }
+  std::size_t cols() const { return n; }
+
+  /* apply(): compute the product r = A * x.
+   */
+  virtual void apply(const vec& x, vecref r) const = 0;
+
+  /* adjoint(): compute the product x = A' * r.
+   */
+  virtual void adjoint(const vec& r, vecref x) const = 0;
+
+  /* apply_cols(): compute the product R = A * X for every column
+   * of a matrix, e.g. one column per sampler chain.
+   */
+  virtual void apply_cols(const Eigen::MatrixXd& X, Eigen::MatrixXd& R) const {
+    R.resize(m, X.cols());
+    for (Eigen::Index c = 0; c < X.cols(); c++)
+      apply(X.col(c), R.col(c));
+  }
+
+  /* adjoint_cols(): compute the product X = A' * R for every column
+   * of a matrix.
+   */
+  virtual void adjoint_cols(const Eigen::MatrixXd& R, Eigen::MatrixXd& X) const {
+    X.resize(n, R.cols());
+    for (Eigen::Index c = 0; c < R.cols(); c++)
+      adjoint(R.col(c), X.col(c));
+  }
+
+  /* colnorms(): return the squared column norms, i.e. the diagonal
+   * of the gramian A' * A.
+   */
+  virtual Eigen::VectorXd colnorms() const = 0;
+
+  /* rownorms(): return the weighted squared row norms, i.e. the
+   * diagonal of A * diag(d) * A'.
+   */
+  virtual Eigen::VectorXd rownorms(const Eigen::VectorXd& d) const = 0;
+
+  /* rownorms(): return the weighted squared row norms over a subset of
+   * the columns, given by their indices, with one weight per index.
+   * by default, the weights are scattered into a full-length vector.
+   */
+  virtual Eigen::VectorXd rownorms(const Eigen::VectorXd& d,
+                                   const std::vector<std::size_t>& idx) const {
+    Eigen::VectorXd df = Eigen::VectorXd::Zero(n);
+    for (std::size_t j = 0; j < idx.size(); j++)
+      df(idx[j]) = d(j);
+
+    return rownorms(df);
+  }
+
+  /* grad(): compute the gradient g = tau * A' * (A * x - y).
+   */
+  virtual void grad(const vec& x, const vec& y, double tau, vecref g) const {
+    Eigen::VectorXd r{m};
+    apply(x, r);
+    r -= y;
+    adjoint(r, g);
+    g *= tau;
+  }
+
+  /* gram(): return the dense m-by-m matrix A * diag(d) * A'.
+   */
+  virtual Eigen::MatrixXd gram(const Eigen::VectorXd& d) const {
+    /* build the result one column at a time. */
+    Eigen::MatrixXd G{m, m};
+    Eigen::VectorXd e{m}, x{n};
+    for (std::size_t i = 0; i < m; i++) {
+      e.setZero();
+      e(i) = 1;
+      adjoint(e, x);
+      x.array() *= d.array();
+      apply(x, G.col(i));
+    }
+
+    return G;
+  }
+
+  /* columns(): return the restriction of the operator to a subset of
+   * its columns, given by their sorted indices.
+   */
+  virtual std::shared_ptr<const op>
+  columns(const std::vector<std::size_t>& idx) const;
+
+protected:
+  /* struct members:
+   *
+   *  @m: number of rows.
+   *  @n: number of columns.
+   */
+  std::size_t m, n;
+};
+
+/* op_cols: restriction of an operator to a subset of its columns.
+ *
+ * products are computed by the full operator, scattering into and
+ * gathering from full-length vectors. this is used by operators that
+ * have no cheaper way of dropping columns, e.g. fast transforms.
+ */
+struct op_cols : public op {
+public:
+  /* op_cols(): constructor, takes the full operator and the indices
+   * of the kept columns.
+   */
+  op_cols(std::shared_ptr<const op> full, const std::vector<std::size_t>& idx)
+   : op(full->rows(), idx.size()), A{std::move(full)}, cols{idx} {}
+
+  void apply(const vec& x, vecref r) const override {
+    Eigen::VectorXd xf = Eigen::VectorXd::Zero(A->cols());
+    for (std::size_t j = 0; j < n; j++)
+      xf(cols[j]) = x(j);
+
+    A->apply(xf, r);
+  }
+
+  void adjoint(const vec& r, vecref x) const override {
+    Eigen::VectorXd xf{A->cols()};
+    A->adjoint(r, xf);
+    for (std::size_t j = 0; j < n; j++)
+      x(j) = xf(cols[j]);
+  }
+
+  Eigen::VectorXd colnorms() const override {
+    const Eigen::VectorXd d = A->colnorms();
+    Eigen::VectorXd dc{n};
+    for (std::size_t j = 0; j < n; j++)
+      dc(j) = d(cols[j]);
+
+    return dc;
+  }
+
+  Eigen::VectorXd rownorms(const Eigen::VectorXd& d) const override {
+    return A->rownorms(d, cols);
+  }
+
+private:
+  /* struct members:
+   *
+   *  @A: full operator.
+   *  @cols: indices of the kept columns.
+   */
+  std::shared_ptr<const op> A;
+  std::vector<std::size_t> cols;
+};
+
+/* op_dense: explicitly stored dense sensing matrix.
+ */
+struct op_dense : public op {
+public:
+  /* op_dense(): constructor, takes ownership of a dense matrix.
+   */
+  op_dense(matrix&& mat)
+   : op_dense(std::make_shared<const matrix>(std::move(mat))) {}
+
+  /* op_dense(): constructor, takes row-major matrix elements held in
+   * memory that is kept alive by an owner, e.g. a mapped file.
+   */
+  op_dense(const double *data, std::size_t rows, std::size_t cols,
+           std::shared_ptr<const void> owner)
+   : op(rows, cols), mem{std::move(owner)}, A{data, Eigen::Index(rows),
+                                                   Eigen::Index(cols)} {}
+
+  /* data(): return the row-major matrix elements.
+   */
+  const double *data() const { return A.data(); }
+
+  void apply(const vec& x, vecref r) const override {
+    r.noalias() = A * x;
+  }
+
+  void adjoint(const vec& r, vecref x) const override {
+    x.noalias() = A.transpose() * r;
+  }
+
+  void apply_cols(const Eigen::MatrixXd& X, Eigen::MatrixXd& R) const override {
+    R.noalias() = A * X;
+  }
+
+  void adjoint_cols(const Eigen::MatrixXd& R, Eigen::MatrixXd& X) const override {
+    X.noalias() = A.transpose() * R;
+  }
+
+  Eigen::VectorXd colnorms() const override {
+    return A.colwise().squaredNorm().transpose();
+  }
+
+  /* rownorms(): accumulate each weighted squared row in storage order,
+   * without forming the squared matrix.
+   */
+  Eigen::VectorXd rownorms(const Eigen::VectorXd& d) const override {
+    Eigen::VectorXd r{m};
+    for (std::size_t i = 0; i < m; i++)
+      r(i) = A.row(i).cwiseAbs2().dot(d.transpose());
+
+    return r;
+  }
+
+  /* grad(): compute the gradient in a single sweep over row panels of
+   * the matrix. each panel is sized to remain in cache between the
+   * product that computes its residual entries and the transposed
+   * product that accumulates them, so the matrix is only read from
+   * memory once.
+   */
+  void grad(const vec& x, const vec& y, double tau, vecref g) const override {
+    /* determine the number of rows per panel. */
+    constexpr std::size_t cache = 256 * 1024;
+    const std::size_t rows = std::max<std::size_t>(4, cache / (8 * n));
+    Eigen::VectorXd r{std::min(rows, m)};
+
+    /* accumulate the gradient over each panel. */
+    g.setZero();
+    for (std::size_t i = 0; i < m; i += rows) {
+      const std::size_t nr = std::min(rows, m - i);
+      const auto P = A.middleRows(i, nr);
+      auto rp = r.head(nr);
+
+      /* compute the panel residual, and apply its transpose. */
+      rp.noalias() = P * x;
+      rp -= y.segment(i, nr);
+      g.noalias() += P.transpose() * rp;
+    }
+
+    /* scale the result. */
+    g *= tau;
+  }
+
+  Eigen::MatrixXd gram(const Eigen::VectorXd& d) const override {
+    return A * d.asDiagonal() * A.transpose();
+  }
+
+  /* columns(): copy the kept columns into a compact matrix, so that
+   * products only read the elements of the kept columns.
+   */
+  std::shared_ptr<const op>
+  columns(const std::vector<std::size_t>& idx) const override {
+    matrix B{m, idx.size()};
+    for (std::size_t j = 0; j < idx.size(); j++)
+      B.col(j) = A.col(idx[j]);
+
+    return std::make_shared<op_dense>(std::move(B));
+  }
+
+private:
+  /* op_dense(): constructor, takes a shared dense matrix.
+   */
+  op_dense(std::shared_ptr<const matrix> mat)
+   : op_dense(mat->data(), mat->rows(), mat->cols(), mat) {}
+
+  /* struct members:
+   *
+   *  @mem: owner of the matrix elements.
+   *  @A: dense sensing matrix.
+   */
+  std::shared_ptr<const void> mem;
+  Eigen::Map<const matrix> A;
+};
+
+/* op_sparse: explicitly stored sparse sensing matrix, in compressed
+ * row (csr) form.
+ */
+struct op_sparse : public op {
+public:
+  using spmatrix = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
+  /* op_sparse(): constructor, takes ownership of a sparse matrix.
+   */
+  op_sparse(spmatrix&& mat) : op(mat.rows(), mat.cols()), A{std::move(mat)} {}
+
+  void apply(const vec& x, vecref r) const override {
+    r.noalias() = A * x;
+  }
+
+  void adjoint(const vec& r, vecref x) const override {
+    x.noalias() = A.transpose() * r;
+  }
+
+  void apply_cols(const Eigen::MatrixXd& X, Eigen::MatrixXd& R) const override {
+    R.noalias() = A * X;
+  }
+
+  void adjoint_cols(const Eigen::MatrixXd& R, Eigen::MatrixXd& X) const override {
+    X.noalias() = A.transpose() * R;
+  }
+
+  Eigen::VectorXd colnorms() const override {
+    Eigen::VectorXd d = Eigen::VectorXd::Zero(n);
+    for (Eigen::Index i = 0; i < A.outerSize(); i++)
+      for (spmatrix::InnerIterator it(A, i); it; ++it)
+        d(it.col()) += it.value() * it.value();
+
+    return d;
+  }
+
+  Eigen::VectorXd rownorms(const Eigen::VectorXd& d) const override {
+    Eigen::VectorXd r{m};
+    for (Eigen::Index i = 0; i < A.outerSize(); i++) {
+      r(i) = 0;
+      for (spmatrix::InnerIterator it(A, i); it; ++it)
+        r(i) += it.value() * it.value() * d(it.col());
+    }
+
+    return r;
+  }
+
+  /* grad(): compute the gradient in a single sweep over the rows of
+   * the matrix, forming each residual entry and immediately scattering
+   * it back along the same row.
+   */
+  void grad(const vec& x, const vec& y, double tau, vecref g) const override {
+    g.setZero();
+    for (Eigen::Index i = 0; i < A.outerSize(); i++) {
+      double r = -y(i);
+      for (spmatrix::InnerIterator it(A, i); it; ++it)
+        r += it.value() * x(it.col());
+
+      r *= tau;
+      for (spmatrix::InnerIterator it(A, i); it; ++it)
+        g(it.col()) += r * it.value();
+    }
+  }
+
+  Eigen::MatrixXd gram(const Eigen::VectorXd& d) const override {
+    const spmatrix G = A * d.asDiagonal() * A.transpose();
+    return Eigen::MatrixXd{G};
+  }
+
+  /* columns(): copy the entries of the kept columns into a compact
+   * sparse matrix.
+   */
+  std::shared_ptr<const op>
+  columns(const std::vector<std::size_t>& idx) const override {
+    /* map each column to its new index, or to -1 if dropped. */
+    std::vector<Eigen::Index> pos(n, -1);
+    for (std::size_t j = 0; j < idx.size(); j++)
+      pos[idx[j]] = j;
+
+    /* gather the kept entries. */
+    std::vector<Eigen::Triplet<double>> T;
+    for (Eigen::Index i = 0; i < A.outerSize(); i++)
+      for (spmatrix::InnerIterator it(A, i); it; ++it)
+        if (pos[it.col()] >= 0)
+          T.emplace_back(i, pos[it.col()], it.value());
+
+    spmatrix B(m, idx.size());
+    B.setFromTriplets(T.begin(), T.end());
+    return std::make_shared<op_sparse>(std::move(B));
+  }
+
+private:
+  /* struct members:
+   *
+   *  @A: sparse sensing matrix.
+   */
+  spmatrix A;
+};
+
+/* op_dct: randomly row-subsampled orthonormal type-II discrete cosine
+ * transform, with rows
+ *
+ *  A(i,j) = a(k) * cos(pi * k * (2j + 1) / 2n),  k = rows(i),
+ *
+ * where a(0) = sqrt(1/n) and a(k) = sqrt(2/n) otherwise. products are
+ * computed by zero-padded fourier transforms of length 2n.
+ */
+struct op_dct : public op {
+public:
+  /* op_dct(): constructor, takes the selected frequency indices.
+   */
+  op_dct(std::size_t cols, const std::vector<std::size_t>& idx)
+   : op(idx.size(), cols), rows{idx}, f{2 * cols} {}
+
+  void apply(const vec& x, vecref r) const override {
+    /* transform the zero-padded input. */
+    fft::cvec a(2 * n, 0);
+    for (std::size_t j = 0; j < n; j++)
+      a[j] = x(j);
+
+    f(a);
+
+    /* extract the selected, shifted and scaled coefficients. */
+    for (std::size_t i = 0; i < m; i++) {
+      const std::size_t k = rows[i];
+      r(i) = scale(k) * std::real(a[k] * shift(k, -1));
+    }
+  }
+
+  void adjoint(const vec& r, vecref x) const override {
+    /* scatter the shifted and scaled coefficients. */
+    fft::cvec a(2 * n, 0);
+    for (std::size_t i = 0; i < m; i++) {
+      const std::size_t k = rows[i];
+      a[k] = scale(k) * r(i) * shift(k, 1);
+    }
+
+    /* inverse transform, keeping the first half. */
+    f(a, true);
+    for (std::size_t j = 0; j < n; j++)
+      x(j) = std::real(a[j]);
+  }
+
+  /* colnorms(): use cos^2(t) = (1 + cos(2t)) / 2 to express the column
+   * norms as a single inverse transform of the squared row scales.
+   */
+  Eigen::VectorXd colnorms() const override {
+    double c = 0;
+    fft::cvec a(2 * n, 0);
+    for (const std::size_t k : rows) {
+      a[k] = std::pow(scale(k), 2) / 2;
+      c += std::real(a[k]);
+    }
+
+    f(a, true);
+    Eigen::VectorXd d{n};
+    for (std::size_t j = 0; j < n; j++)
+      d(j) = c + std::real(a[2 * j + 1]);
+
+    return d;
+  }
+
+  /* rownorms(): by the same identity, each row norm is a weighted sum
+   * plus the cosine transform of the weights at the doubled frequency.
+   */
+  Eigen::VectorXd rownorms(const Eigen::VectorXd& d) const override {
+    fft::cvec a(2 * n, 0);
+    for (std::size_t j = 0; j < n; j++)
+      a[j] = d(j);
+
+    f(a);
+    const double c = d.sum();
+    Eigen::VectorXd r{m};
+    for (std::size_t i = 0; i < m; i++) {
+      const std::size_t k = rows[i];
+      r(i) = std::pow(scale(k), 2) / 2 *
+             (c + std::real(a[2 * k] * shift(2 * k, -1)));
+    }
+
+    return r;
+  }
+
+  /* rownorms(): over a subset of the columns, sum the weighted squared
+   * elements directly, which is cheaper than a transform when only a
+   * few columns remain.
+   */
+  Eigen::VectorXd rownorms(const Eigen::VectorXd& d,
+                           const std::vector<std::size_t>& idx) const override {
+    Eigen::VectorXd r{m};
+    for (std::size_t i = 0; i < m; i++) {
+      const std::size_t k = rows[i];
+      double sum = 0;
+      for (std::size_t j = 0; j < idx.size(); j++)
+        sum += d(j) * std::pow(std::cos(pi * k * (2 * idx[j] + 1) / (2.0 * n)), 2);
+
+      r(i) = std::pow(scale(k), 2) * sum;
+    }
+
+    return r;
+  }
+
+private:
+  /* scale(): return the orthonormal scale factor of a frequency.
+   */
+  double scale(std::size_t k) const {
+    return std::sqrt((k ? 2.0 : 1.0) / n);
+  }
+
+  /* shift(): return the half-sample phase shift of a frequency.
+   */
+  fft::cplx shift(std::size_t k, int sign) const {
+    return std::polar(1.0, sign * pi * k / (2.0 * n));
+  }
+
+  /* struct members:
+   *
+   *  @rows: selected frequency of each row.
+   *  @f: fourier transform of length 2n.
+   */
+  static constexpr double pi = 3.14159265358979323846264338327950288;
+  std::vector<std::size_t> rows;
+  fft f;
+};
+
+/* op_dft: randomly row-subsampled real orthonormal fourier transform.
+ *
+ * the n rows of the complete transform are indexed by r, where row 0
+ * is the constant (dc) row, rows 2f-1 and 2f hold the cosine and sine
+ * at frequency f, and for even n the last row holds the alternating
+ * (nyquist) row. the dc and nyquist rows are scaled by sqrt(1/n), all
+ * others by sqrt(2/n).
+ */
+struct op_dft : public op {
+public:
+  /* op_dft(): constructor, takes the selected row indices.
+   */
+  op_dft(std::size_t cols, const std::vector<std::size_t>& idx)
+   : op(idx.size(), cols), rows{idx}, f{cols} {}
+
+  void apply(const vec& x, vecref r) const override {
+    /* transform the input. */
+    fft::cvec a(n);
+    for (std::size_t j = 0; j < n; j++)
+      a[j] = x(j);
+
+    f(a);
+
+    /* extract the real or negated imaginary parts of each row. */
+    for (std::size_t i = 0; i < m; i++) {
+      const auto [k, sine, s] = decode(rows[i]);
+      r(i) = s * (sine ? -std::imag(a[k]) : std::real(a[k]));
+    }
+  }
+
+  void adjoint(const vec& r, vecref x) const override {
+    /* scatter each row into the spectrum. */
+    fft::cvec a(n, 0);
+    for (std::size_t i = 0; i < m; i++) {
+      const auto [k, sine, s] = decode(rows[i]);
+      a[k] += (sine ? fft::cplx{0, -s * r(i)} : fft::cplx{s * r(i), 0});
+    }
+
+    /* inverse transform, keeping the real part. */
+    f(a, true);
+    for (std::size_t j = 0; j < n; j++)
+      x(j) = std::real(a[j]);
+  }
+
+  /* colnorms(): use cos^2(t) = (1 + cos(2t)) / 2 and sin^2(t) =
+   * (1 - cos(2t)) / 2 to express the column norms as a single inverse
+   * transform over doubled frequencies.
+   */
+  Eigen::VectorXd colnorms() const override {
+    double c = 0;
+    fft::cvec a(n, 0);
+    for (const std::size_t r : rows) {
+      const auto [k, sine, s] = decode(r);
+      if (k == 0 || 2 * k == n) {
+        c += s * s;
+        continue;
+      }
+
+      c += s * s / 2;
+      a[(2 * k) % n] += (sine ? -1 : 1) * s * s / 2;
+    }
+
+    f(a, true);
+    Eigen::VectorXd d{n};
+    for (std::size_t j = 0; j < n; j++)
+      d(j) = c + std::real(a[j]);
+
+    return d;
+  }
+
+  /* rownorms(): by the same identities, each row norm is a weighted
+   * sum plus or minus the transform of the weights at the doubled
+   * frequency.
+   */
+  Eigen::VectorXd rownorms(const Eigen::VectorXd& d) const override {
+    fft::cvec a(n);
+    for (std::size_t j = 0; j < n; j++)
+      a[j] = d(j);
+
+    f(a);
+    const double c = d.sum();
+    Eigen::VectorXd r{m};
+    for (std::size_t i = 0; i < m; i++) {
+      const auto [k, sine, s] = decode(rows[i]);
+      if (k == 0 || 2 * k == n)
+        r(i) = s * s * c;
+      else
+        r(i) = s * s / 2 * (c + (sine ? -1 : 1) * std::real(a[(2 * k) % n]));
+    }
+
+    return r;
+  }
+
+  /* rownorms(): over a subset of the columns, sum the weighted squared
+   * elements directly.
+   */
+  Eigen::VectorXd rownorms(const Eigen::VectorXd& d,
+                           const std::vector<std::size_t>& idx) const override {
+    Eigen::VectorXd r{m};
+    for (std::size_t i = 0; i < m; i++) {
+      const auto [k, sine, s] = decode(rows[i]);
+      double sum = 0;
+      for (std::size_t j = 0; j < idx.size(); j++) {
+        const double t = 2 * pi * ((k * idx[j]) % n) / n;
+        sum += d(j) * std::pow(sine ? std::sin(t) : std::cos(t), 2);
+      }
+
+      r(i) = s * s * sum;
+    }
+
+    return r;
+  }
+
+private:
+  /* decode(): map a row index to its frequency, its type (cosine or
+   * sine) and its scale factor.
+   */
+  std::tuple<std::size_t, bool, double> decode(std::size_t r) const {
+    const std::size_t k = (r + 1) / 2;
+    const bool sine = r && !(r % 2);
+    const bool edge = (k == 0 || 2 * k == n);
+    return {k, sine, std::sqrt((edge ? 1.0 : 2.0) / n)};
+  }
+
+  /* struct members:
+   *
+   *  @rows: selected row indices.
+   *  @f: fourier transform of length n.
+   */
+  static constexpr double pi = 3.14159265358979323846264338327950288;
+  std::vector<std::size_t> rows;
+  fft f;
+};
+
+/* columns(): by default, restrict the operator by scattering and
+ * gathering around products with the full operator.
+ */
+inline std::shared_ptr<const op>
+op::columns(const std::vector<std::size_t>& idx) const {
+  return std::make_shared<op_cols>(shared_from_this(), idx);
+}
+
+/* sensing: shared handle to a sensing operator that supports
+ * the product syntax of dense matrices, i.e. A * x and A' * r.
+ */
+struct sensing {
+public:
+  /* adjoint: proxy type returned by transpose().
+   */
+  struct adjoint {
+    const op& p;
+
+    Eigen::VectorXd operator*(const vec& r) const {
+      Eigen::VectorXd x{p.cols()};
+      p.adjoint(r, x);
+      return x;
+    }
+  };
+
+  /* operator*(): return the product A * x.
+   */
+  Eigen::VectorXd operator*(const vec& x) const {
+    Eigen::VectorXd r{p->rows()};
+    p->apply(x, r);
+    return r;
+  }
+
+  /* transpose(): return a proxy for products with A'.
+   */
+  adjoint transpose() const { return {*p}; }
+
+  /* operator->(): access the underlying operator.
+   */
+  const op* operator->() const { return p.get(); }
+
+  /* struct members:
+   *
+   *  @p: shared pointer to the operator.
+   */
+  std::shared_ptr<const op> p;
+};
@@ -3,12 +3,14 @@
  * Released under the MIT License.
  */
 
-int main(int argc, char **argv) {
-  /* initialize the problem instance. */
-  inst_init(argc, argv);
-
+/* solve(): run the solver on the current problem instance.
+ */
+static void solve(std::ostream& out, std::ostream& err) {
   /* output the ground-truth signal with zero variance. */
-  for (std::size_t i = 0; i < n; i++)
-    std::cout << x0(i) << " " << 0 << "\n";
+  inst_output(out, err, x0);
 }
 
+int main(int argc, char **argv) {
+  /* solve the problem instance. */
+  return inst_main(argc, argv, solve);
+}
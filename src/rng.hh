@@ -0,0 +1,149 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <array>
+#include <Eigen/Dense>
+
+/* philox(): philox-4x32-10 counter-based pseudorandom function.
+ *
+ * maps a 128-bit counter and a 64-bit key to 128 random bits, so the
+ * i-th block of a stream is computed directly from i, independently
+ * of all other blocks. this makes streams reproducible regardless of
+ * how their blocks are batched, vectorized or split among threads.
+ */
+static inline std::array<uint32_t, 4>
+philox(std::array<uint32_t, 4> c, std::array<uint32_t, 2> k) {
+  /* multipliers and key schedule increments. */
+  constexpr uint64_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+  constexpr uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+  /* run the rounds. */
+  for (int r = 0; r < 10; r++) {
+    const uint64_t p0 = M0 * c[0];
+    const uint64_t p1 = M1 * c[2];
+    c = {uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1),
+         uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0)};
+
+    k[0] += W0;
+    k[1] += W1;
+  }
+
+  return c;
+}
+
+/* stream: independent, counter-based pseudorandom stream, e.g. for one
+ * sampler chain.
+ *
+ * the stream is a sequence of blocks, each holding two 64-bit words.
+ * uniform variates take one word each, and normal variates are drawn
+ * in pairs from the two words of a block by the box-muller transform.
+ */
+struct stream {
+public:
+  /* stream(): constructor, takes a seed and a stream index.
+   */
+  stream(std::size_t seed, std::size_t id)
+   : key{uint32_t(seed), uint32_t(seed >> 32)},
+     sid{uint32_t(id), uint32_t(id >> 32)},
+     ctr{0}, cached{false}, spare{0} {}
+
+  /* uniform(): draw a standard uniform variate.
+   */
+  double uniform() {
+    double u[2];
+    block(ctr++, u);
+    return u[0];
+  }
+
+  /* normal(): draw a standard normal variate.
+   */
+  double normal() {
+    /* return the second variate of the last pair, if available. */
+    if (cached) {
+      cached = false;
+      return spare;
+    }
+
+    /* draw a new pair, and keep the second variate. */
+    double z[2];
+    pair(ctr++, z);
+    cached = true;
+    spare = z[1];
+    return z[0];
+  }
+
+  /* uniform(): fill a vector with standard uniform variates.
+   */
+  void uniform(Eigen::Ref<Eigen::VectorXd> u) {
+    const std::size_t len = u.size(), num = (len + 1) / 2;
+    for (std::size_t b = 0; b < num; b++) {
+      double v[2];
+      block(ctr + b, v);
+      u(2 * b) = v[0];
+      if (2 * b + 1 < len)
+        u(2 * b + 1) = v[1];
+    }
+
+    ctr += num;
+  }
+
+  /* normal(): fill a vector with standard normal variates.
+   */
+  void normal(Eigen::Ref<Eigen::VectorXd> z) {
+    const std::size_t len = z.size(), num = (len + 1) / 2;
+    for (std::size_t b = 0; b < num; b++) {
+      double v[2];
+      pair(ctr + b, v);
+      z(2 * b) = v[0];
+      if (2 * b + 1 < len)
+        z(2 * b + 1) = v[1];
+    }
+
+    ctr += num;
+  }
+
+private:
+  /* block(): compute the two uniform variates in [0,1) of a block.
+   */
+  void block(uint64_t b, double *u) const {
+    const auto r = philox({uint32_t(b), uint32_t(b >> 32), sid[0], sid[1]},
+                          key);
+
+    constexpr double scale = 1.0 / 9007199254740992.0;
+    const uint64_t w0 = (uint64_t(r[0]) << 32) | r[1];
+    const uint64_t w1 = (uint64_t(r[2]) << 32) | r[3];
+    u[0] = (w0 >> 11) * scale;
+    u[1] = (w1 >> 11) * scale;
+  }
+
+  /* pair(): compute the two normal variates of a block.
+   */
+  void pair(uint64_t b, double *z) const {
+    constexpr double pi2 = 6.28318530717958647692528676655900577;
+    double u[2];
+    block(b, u);
+
+    const double r = std::sqrt(-2 * std::log(1 - u[0]));
+    z[0] = r * std::cos(pi2 * u[1]);
+    z[1] = r * std::sin(pi2 * u[1]);
+  }
+
+  /* struct members:
+   *
+   *  @key: philox key, from the seed.
+   *  @sid: upper half of the philox counter, from the stream index.
+   *  @ctr: index of the next block of the stream.
+   *  @cached: whether a spare normal variate is available.
+   *  @spare: spare normal variate.
+   */
+  std::array<uint32_t, 2> key;
+  std::array<uint32_t, 2> sid;
+  uint64_t ctr;
+  bool cached;
+  double spare;
+};
@@ -0,0 +1,461 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <map>
+#include <cstdio>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* application parameters:
+ *
+ *  @workers: number of worker threads, each driving one resident
+ *   server process per solver. zero uses every core.
+ *  @bindir: directory holding the solver binaries, by default that of
+ *   the sweep binary itself.
+ *  @defaults: arguments passed to every solver server, i.e. the
+ *   defaults of every job.
+ */
+std::size_t workers = 0;
+std::string bindir;
+std::vector<std::string> defaults;
+
+/* instance parameters: keys of the job arguments that determine the
+ * problem instance. this needs to match inst_path() in inst.hh, along
+ * with any parameters forced by the solvers, e.g. orth by irls-ic.
+ */
+const std::vector<std::string> inst_keys{
+  "kind", "k", "m", "n", "seed", "stdev", "orth", "d", "cache"
+};
+
+/* job: a single solver run.
+ *
+ *  @idx: index of the job, in order of submission.
+ *  @solver: name of the solver binary.
+ *  @args: whitespace-separated key=value arguments.
+ *  @key: instance key shared with other jobs, or empty.
+ *  @leader: whether the job generates the instance of its key.
+ */
+struct job {
+  std::size_t idx;
+  std::string solver;
+  std::string args;
+  std::string key;
+  bool leader;
+};
+
+/* server: resident solver process, which reads one job per line on
+ * its stdin and writes one framed result record per job.
+ */
+struct server {
+public:
+  /* server(): constructor, takes the name of the solver binary.
+   */
+  server(const std::string& solver) : pid{-1}, fin{nullptr}, fout{nullptr} {
+    /* build the argument list. */
+    std::vector<std::string> args{bindir + "/" + solver, "serve=-"};
+    args.insert(args.end(), defaults.begin(), defaults.end());
+
+    std::vector<char*> argv;
+    for (auto& arg : args)
+      argv.push_back(&arg[0]);
+
+    argv.push_back(nullptr);
+
+    /* create the pipes. the parent ends are closed on exec, so that
+     * servers spawned by other workers never hold them open.
+     */
+    int pin[2], pout[2];
+    if (pipe2(pin, O_CLOEXEC) < 0)
+      return;
+
+    if (pipe2(pout, O_CLOEXEC) < 0) {
+      close(pin[0]);
+      close(pin[1]);
+      return;
+    }
+
+    /* start the process. */
+    pid = fork();
+    if (pid == 0) {
+      dup2(pin[0], STDIN_FILENO);
+      dup2(pout[1], STDOUT_FILENO);
+      execv(argv[0], argv.data());
+      _exit(127);
+    }
+
+    close(pin[0]);
+    close(pout[1]);
+    fout = fdopen(pin[1], "w");
+    fin = fdopen(pout[0], "r");
+  }
+
+  /* ~server(): destructor, closes the job stream and waits for the
+   * process to exit.
+   */
+  ~server() {
+    if (fout) std::fclose(fout);
+    if (fin) std::fclose(fin);
+    if (pid > 0) waitpid(pid, nullptr, 0);
+  }
+
+  /* run(): run a job, and return its output and diagnostics. returns
+   * false if the process has failed.
+   */
+  bool run(const std::string& args, std::string& out, std::string& err) {
+    /* write the job line. */
+    if (!fout || !fin ||
+        std::fprintf(fout, "%s\n", args.c_str()) < 0 ||
+        std::fflush(fout) != 0)
+      return false;
+
+    /* read the record header and bytes. */
+    std::size_t nout, nerr;
+    if (std::fscanf(fin, "%zu %zu", &nout, &nerr) != 2 ||
+        std::fgetc(fin) != '\n')
+      return false;
+
+    out.resize(nout);
+    err.resize(nerr);
+    return std::fread(&out[0], 1, nout, fin) == nout &&
+           std::fread(&err[0], 1, nerr, fin) == nerr;
+  }
+
+private:
+  server(const server&) = delete;
+  server& operator=(const server&) = delete;
+
+  /* struct members:
+   *
+   *  @pid: process identifier.
+   *  @fin: stream of result records.
+   *  @fout: stream of job lines.
+   */
+  pid_t pid;
+  FILE *fin, *fout;
+};
+
+/* pool: work-stealing pool of worker threads.
+ *
+ * each worker owns a queue of jobs, taking from its back and stealing
+ * from the front of the other queues once empty, so no worker idles
+ * while any job is runnable. jobs sharing an instance key are held
+ * back until the first of them has generated and cached the instance.
+ */
+struct pool {
+public:
+  /* pool(): constructor, takes the number of workers to start.
+   */
+  pool(std::size_t num) : queues(num), queued{0}, active{0}, eof{false} {
+    for (std::size_t w = 0; w < num; w++)
+      threads.emplace_back([this, w] { work(w); });
+  }
+
+  /* submit(): add a job to the pool.
+   */
+  void submit(job j) {
+    /* hold the job back while its instance is being generated. */
+    std::unique_lock<std::mutex> lk(mtx);
+    active++;
+    if (!j.key.empty()) {
+      auto& g = groups[j.key];
+      j.leader = !g.started;
+      g.started = true;
+      if (!j.leader && !g.done) {
+        g.held.push_back(std::move(j));
+        return;
+      }
+    }
+
+    lk.unlock();
+    push(next++ % queues.size(), std::move(j));
+  }
+
+  /* finish(): wait for all submitted jobs, and stop the workers.
+   */
+  void finish() {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      eof = true;
+    }
+
+    cv.notify_all();
+    for (auto& t : threads)
+      t.join();
+  }
+
+private:
+  /* queue: job queue of a single worker.
+   */
+  struct queue {
+    std::mutex mtx;
+    std::deque<job> jobs;
+  };
+
+  /* group: jobs of a shared instance.
+   */
+  struct group {
+    bool started = false;
+    bool done = false;
+    std::vector<job> held;
+  };
+
+  /* push(): add a runnable job to the queue of a worker.
+   *
+   * the count is raised before the job is published, under the pool
+   * lock, so that take() never lowers it below zero and waiting
+   * workers never see a count without its job.
+   */
+  void push(std::size_t w, job j) {
+    {
+      std::lock_guard<std::mutex> lk(mtx);
+      queued++;
+
+      std::lock_guard<std::mutex> lkq(queues[w].mtx);
+      queues[w].jobs.push_back(std::move(j));
+    }
+
+    cv.notify_one();
+  }
+
+  /* take(): take a runnable job for a worker, first from its own
+   * queue, then from those of the others.
+   */
+  bool take(std::size_t w, job& j) {
+    const std::size_t num = queues.size();
+    for (std::size_t i = 0; i < num; i++) {
+      queue& q = queues[(w + i) % num];
+      std::unique_lock<std::mutex> lk(q.mtx);
+      if (q.jobs.empty())
+        continue;
+
+      if (i == 0) {
+        j = std::move(q.jobs.back());
+        q.jobs.pop_back();
+      }
+      else {
+        j = std::move(q.jobs.front());
+        q.jobs.pop_front();
+      }
+
+      lk.unlock();
+      std::lock_guard<std::mutex> lk2(mtx);
+      queued--;
+      return true;
+    }
+
+    return false;
+  }
+
+  /* work(): main loop of a worker.
+   */
+  void work(std::size_t w) {
+    std::map<std::string, std::unique_ptr<server>> servers;
+    while (true) {
+      /* wait for a runnable job, or for the end of the sweep. */
+      job j;
+      if (!take(w, j)) {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [this] { return queued > 0 || (eof && active == 0); });
+        if (queued == 0)
+          break;
+
+        continue;
+      }
+
+      /* run the job, restarting the server once if it has failed. */
+      std::string out, err;
+      auto& srv = servers[j.solver];
+      bool ok = false;
+      for (int attempt = 0; attempt < 2 && !ok; attempt++) {
+        if (!srv || attempt > 0)
+          srv = std::make_unique<server>(j.solver);
+
+        ok = srv->run(j.args, out, err);
+      }
+
+      if (!ok) {
+        srv.reset();
+        out.clear();
+        err = "error " + j.solver + " server failed\n";
+      }
+
+      /* write the result record. */
+      {
+        std::lock_guard<std::mutex> lk(omtx);
+        std::fprintf(stdout, "%zu %zu %zu\n", j.idx, out.size(), err.size());
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fwrite(err.data(), 1, err.size(), stdout);
+        std::fflush(stdout);
+      }
+
+      /* release the jobs waiting on the instance of a leader. */
+      std::vector<job> held;
+      {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (j.leader) {
+          auto& g = groups[j.key];
+          g.done = true;
+          held.swap(g.held);
+        }
+      }
+
+      for (auto& h : held)
+        push(w, std::move(h));
+
+      /* mark the job as complete. */
+      bool last;
+      {
+        std::lock_guard<std::mutex> lk(mtx);
+        last = (--active == 0 && eof);
+      }
+
+      if (last)
+        cv.notify_all();
+    }
+  }
+
+  /* struct members:
+   *
+   *  @queues: job queues, one per worker.
+   *  @threads: worker threads.
+   *  @groups: shared instances, by key.
+   *  @queued: number of runnable jobs in all queues.
+   *  @active: number of submitted jobs not yet complete.
+   *  @next: worker queue receiving the next submitted job.
+   *  @eof: whether all jobs have been submitted.
+   *  @mtx, @cv: lock and condition of the counters and groups.
+   *  @omtx: lock of the output stream.
+   */
+  std::vector<queue> queues;
+  std::vector<std::thread> threads;
+  std::map<std::string, group> groups;
+  std::size_t queued, active, next = 0;
+  bool eof;
+  std::mutex mtx, omtx;
+  std::condition_variable cv;
+};
+
+/* expand(): expand a sweep line into jobs.
+ *
+ * the line holds a solver name, followed by key=value arguments. any
+ * solver or value may be a comma-separated list, and the line expands
+ * into all combinations, varying the last field fastest.
+ */
+static std::vector<job> expand(const std::string& line) {
+  /* split the line into fields, and each field into values. */
+  std::vector<std::string> keys;
+  std::vector<std::vector<std::string>> vals;
+  std::istringstream iss(line);
+  for (std::string field; iss >> field;) {
+    const auto idx = field.find_first_of('=');
+    const bool named = (idx != std::string::npos && !keys.empty());
+    keys.push_back(named ? field.substr(0, idx) : "");
+
+    std::vector<std::string> list;
+    std::istringstream fss(named ? field.substr(idx + 1) : field);
+    for (std::string val; std::getline(fss, val, ',');)
+      list.push_back(val);
+
+    if (list.empty())
+      list.push_back("");
+
+    vals.push_back(list);
+  }
+
+  /* build every combination of values. */
+  std::vector<job> jobs;
+  std::vector<std::size_t> sel(vals.size(), 0);
+  while (!vals.empty()) {
+    /* build the arguments, and the values of the instance keys. */
+    job j{0, vals[0][sel[0]], "", "", false};
+    std::map<std::string, std::string> inst;
+    for (const auto& arg : defaults) {
+      const auto idx = arg.find_first_of('=');
+      if (idx != std::string::npos)
+        inst[arg.substr(0, idx)] = arg.substr(idx + 1);
+    }
+
+    for (std::size_t f = 1; f < vals.size(); f++) {
+      const std::string& val = vals[f][sel[f]];
+      j.args += (f > 1 ? " " : "") + keys[f] + (keys[f].empty() ? "" : "=") + val;
+      if (!keys[f].empty())
+        inst[keys[f]] = val;
+    }
+
+    /* orthonormalization is a flag, which irls-ic always sets. */
+    const std::string& o = inst["orth"];
+    const bool orth = (o.compare("y") == 0 || o.compare("yes") == 0 ||
+                       o.compare("true") == 0 ||
+                       j.solver.compare("irls-ic") == 0);
+    inst["orth"] = (orth ? "y" : "n");
+
+    /* key the job by its instance, if instances are cached. */
+    if (!inst["cache"].empty())
+      for (const auto& key : inst_keys)
+        j.key += key + "=" + inst[key] + " ";
+
+    jobs.push_back(j);
+
+    /* advance to the next combination. */
+    std::size_t f = vals.size();
+    while (f > 0 && ++sel[f - 1] == vals[f - 1].size())
+      sel[--f] = 0;
+
+    if (f == 0)
+      break;
+  }
+
+  return jobs;
+}
+
+int main(int argc, char **argv) {
+  /* parse the driver arguments, and keep the rest as job defaults. */
+  const std::string self(argv[0]);
+  const auto slash = self.find_last_of('/');
+  bindir = (slash == std::string::npos ? "." : self.substr(0, slash));
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg.compare(0, 8, "workers=") == 0)
+      workers = std::stoul(arg.substr(8));
+    else if (arg.compare(0, 4, "bin=") == 0)
+      bindir = arg.substr(4);
+    else
+      defaults.push_back(arg);
+  }
+
+  if (workers == 0)
+    workers = std::max(1u, std::thread::hardware_concurrency());
+
+  /* failed servers are detected by their streams. */
+  signal(SIGPIPE, SIG_IGN);
+
+  /* submit the jobs of each sweep line on stdin. results are written
+   * to stdout as they complete, each record headed by its job index.
+   */
+  pool p{workers};
+  std::size_t idx = 0;
+  for (std::string line; std::getline(std::cin, line);) {
+    for (auto& j : expand(line)) {
+      j.idx = idx++;
+      p.submit(std::move(j));
+    }
+  }
+
+  /* wait for the remaining jobs. */
+  p.finish();
+  return 0;
+}
@@ -0,0 +1,136 @@
+
+/* Copyright (c) 2019 Bradley Worley <geekysuavo@gmail.com>
+ * Released under the MIT License.
+ */
+
+#pragma once
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+/* trace_phase: parts of a solver iteration that are timed separately:
+ * the x-update or x-draw, the weight update, any auxiliary work (e.g.
+ * dual steps, noise draws, extrapolation), and the convergence check.
+ */
+enum trace_phase {
+  trace_x, trace_w, trace_aux, trace_check, trace_nphase
+};
+
+/* trace_field: values stored for each sampled iteration. the phase
+ * times are accumulated over all iterations since the last sample.
+ */
+enum trace_field {
+  trace_it, trace_obj, trace_resid, trace_wmin, trace_wmax, trace_step,
+  trace_time, trace_t0, trace_nfield = trace_t0 + trace_nphase
+};
+
+/* trace_names: names of the trace fields.
+ */
+static const char *trace_names[trace_nfield] = {
+  "it", "obj", "resid", "wmin", "wmax", "step", "time",
+  "t_x", "t_w", "t_aux", "t_check"
+};
+
+/* trace_record: a sampled iteration.
+ */
+using trace_record = std::array<double, trace_nfield>;
+
+/* trace_buffer: ring buffer of sampled iterations, with phase timers.
+ *
+ * the buffer is allocated once per run, so sampling never allocates.
+ * once full, each new sample overwrites the oldest one.
+ */
+struct trace_buffer {
+public:
+  using clock = std::chrono::steady_clock;
+
+  /* reset(): clear the buffer, and start the clock of a new run.
+   */
+  void reset(std::size_t capacity) {
+    buf.assign(std::max<std::size_t>(capacity, 1), trace_record{});
+    head = count = 0;
+    acc.fill(0);
+    cur = -1;
+    t0 = last = clock::now();
+  }
+
+  /* phase(): start timing a phase, ending the current one.
+   */
+  void phase(int p) {
+    const auto now = clock::now();
+    if (cur >= 0)
+      acc[cur] += std::chrono::duration<double>(now - last).count();
+
+    last = now;
+    cur = p;
+  }
+
+  /* pause(), resume(): exclude the time spent in between, e.g. while
+   * computing the sampled values, from the current phase.
+   */
+  void pause() {
+    phase(cur);
+    paused = cur;
+    cur = -1;
+  }
+
+  void resume() { phase(paused); }
+
+  /* record(): store a sample, along with the phase times accumulated
+   * since the previous one.
+   */
+  void record(trace_record r) {
+    r[trace_time] = std::chrono::duration<double>(last - t0).count();
+    for (int p = 0; p < trace_nphase; p++)
+      r[trace_t0 + p] = acc[p];
+
+    acc.fill(0);
+    buf[(head + count) % buf.size()] = r;
+    if (count < buf.size())
+      count++;
+    else
+      head = (head + 1) % buf.size();
+  }
+
+  /* column(): return the values of a field, oldest first.
+   */
+  std::vector<double> column(int f) const {
+    std::vector<double> v(count);
+    for (std::size_t i = 0; i < count; i++)
+      v[i] = buf[(head + i) % buf.size()][f];
+
+    return v;
+  }
+
+  /* size(): return the number of stored samples.
+   */
+  std::size_t size() const { return count; }
+
+  /* records(): return the stored samples, oldest first.
+   */
+  std::vector<trace_record> records() const {
+    std::vector<trace_record> v(count);
+    for (std::size_t i = 0; i < count; i++)
+      v[i] = buf[(head + i) % buf.size()];
+
+    return v;
+  }
+
+private:
+  /* struct members:
+   *
+   *  @buf: preallocated samples.
+   *  @head: index of the oldest sample.
+   *  @count: number of stored samples.
+   *  @acc: phase times since the last sample.
+   *  @cur, @paused: current and paused phases, or -1.
+   *  @t0, @last: start of the run and of the current phase.
+   */
+  std::vector<trace_record> buf;
+  std::size_t head = 0, count = 0;
+  std::array<double, trace_nphase> acc{};
+  int cur = -1, paused = -1;
+  clock::time_point t0, last;
+};
@@ -3,10 +3,9 @@
  * Released under the MIT License.
  */
 
-int main(int argc, char **argv) {
-  /* initialize the problem instance. */
-  inst_init(argc, argv);
-
+/* solve(): run the solver on the current problem instance.
+ */
+static void solve(std::ostream& out, std::ostream& err) {
   /* initialize the mean of x. */
   Eigen::VectorXd mu;
   mu.resize(n);
@@ -17,10 +16,10 @@ int main(int argc, char **argv) {
   gamma.resize(n);
   gamma.setOnes();
 
-  /* initialize an auxiliary variable. */
-  Eigen::VectorXd z;
-  z.resize(n);
-  z.setZero();
+  /* initialize the gradient of the data misfit. */
+  Eigen::VectorXd g;
+  g.resize(n);
+  g.setZero();
 
   /* initialize the weight means. */
   Eigen::VectorXd nu_w;
@@ -30,30 +29,108 @@ int main(int argc, char **argv) {
   /* initialize the noise precision and weight precision means. */
   double nu_tau = 1, nu_xi = 1;
 
-  /* iterate. */
-  for (std::size_t it = 0; it < iters; it++) {
+  /* if available, warm-start from a prior state. */
+  inst_warm("x", mu);
+  inst_warm("w", nu_w);
+  inst_warm("xi", nu_xi);
+  inst_warm("tau", nu_tau);
+
+  /* initialize the states of the fixed-point map, with the weight
+   * means and precision means on a log scale to keep them positive
+   * under acceleration.
+   */
+  Eigen::VectorXd s, gs;
+  s.resize(2 * n + 2);
+  gs.resize(2 * n + 2);
+
+  /* iterate until converged, optionally with momentum and anderson
+   * acceleration.
+   */
+  momentum acc{accel};
+  anderson aa{aa_depth};
+  converge conv;
+  active act;
+  double wf = 0, gf = 0;
+  std::size_t it = 0;
+  while (it < iters) {
+    /* restrict the iteration to the active coefficients. */
+    TRACE_PHASE(aux);
+    if (act(it, {&mu, &nu_w, &gamma})) {
+      acc.remap(act, mu);
+      conv.remap(act, mu, nu_w);
+
+      /* sum the terms of the frozen coefficients in the precision
+       * updates, which run over all coefficients.
+       */
+      wf = act.frozen(1).array().inverse().sum();
+      gf = act.frozen_delta().dot(act.frozen(2));
+
+      /* the anderson history spans the whole state, so restart it. */
+      aa = anderson{aa_depth};
+      s.resize(2 * n + 2);
+      gs.resize(2 * n + 2);
+    }
+
+    if (aa_depth)
+      s << mu, nu_w.array().log().matrix(), std::log(nu_xi), std::log(nu_tau);
+
     /* update the mean. */
-    z = mu;
+    TRACE_PHASE(x);
     const double Lt2 = L * nu_tau / 2;
-    mu = (Lt2 * z - nu_tau * A.transpose() * (A * z - y)).array()
-       / (Lt2 + nu_w.array());
+    const Eigen::VectorXd& p = acc.point(mu);
+    grad(p, nu_tau, g);
+    mu = (Lt2 * p - g).array() / (Lt2 + nu_w.array());
+    acc.update(mu, nu_w, nu_tau);
 
     /* update the variance. */
     gamma = (nu_w.array() + nu_tau * delta.array()).inverse();
 
     /* update the weight means. */
+    TRACE_PHASE(w);
     nu_w = (nu_xi * (mu.array().abs2() + gamma.array()).inverse()).sqrt();
 
     /* update the weight precision mean. */
-    nu_xi = std::sqrt(beta_xi / nu_w.array().inverse().sum());
+    nu_xi = std::sqrt(beta_xi / (nu_w.array().inverse().sum() + wf));
 
     /* update the noise precision mean. */
-    const double ess = (y - A * mu).squaredNorm() + delta.dot(gamma);
+    TRACE_PHASE(aux);
+    const double ess = (y - A * mu).squaredNorm() + delta.dot(gamma) + gf;
     nu_tau = std::sqrt(beta_tau / ess);
+
+    /* extrapolate the state. */
+    if (aa_depth) {
+      gs << mu, nu_w.array().log().matrix(), std::log(nu_xi), std::log(nu_tau);
+      aa(s, gs);
+      mu = gs.head(n);
+      nu_w = gs.segment(n, n).array().exp();
+      nu_xi = std::exp(gs(2 * n));
+      nu_tau = std::exp(gs(2 * n + 1));
+    }
+
+    /* check for convergence. */
+    TRACE_ITER(it + 1, mu, nu_w, nu_tau);
+    TRACE_PHASE(check);
+    if (conv(++it, mu, nu_w, act))
+      break;
   }
 
+  /* return to all coefficients. */
+  act.expand({&mu, &nu_w, &gamma});
+
+  /* store the final state. */
+  inst_keep("x", mu);
+  inst_keep("w", nu_w);
+  inst_keep("xi", nu_xi);
+  inst_keep("tau", nu_tau);
+
   /* output the final mean and variance estimates. */
-  for (std::size_t i = 0; i < n; i++)
-    std::cout << mu(i) << " " << gamma(i) << "\n";
+  inst_output(out, err, mu, gamma);
+
+  /* output the number of iterations used. */
+  inst_diag(err, "iters", it);
 }
 
+int main(int argc, char **argv) {
+  /* solve the problem instance. */
+  return inst_main(argc, argv, solve);
+}
@@ -3,10 +3,9 @@
  * Released under the MIT License.
  */
 
-int main(int argc, char **argv) {
-  /* initialize the problem instance. */
-  inst_init(argc, argv);
-
+/* solve(): run the solver on the current problem instance.
+ */
+static void solve(std::ostream& out, std::ostream& err) {
   /* initialize the mean of x. */
   Eigen::VectorXd mu;
   mu.resize(n);
@@ -17,35 +16,99 @@ int main(int argc, char **argv) {
   gamma.resize(n);
   gamma.setOnes();
 
-  /* initialize an auxiliary variable. */
-  Eigen::VectorXd z;
-  z.resize(n);
-  z.setZero();
+  /* initialize the gradient of the data misfit. */
+  Eigen::VectorXd g;
+  g.resize(n);
+  g.setZero();
 
   /* initialize the weight means. */
   Eigen::VectorXd nu;
   nu.resize(n);
   nu.setOnes();
 
+  /* if available, warm-start from a prior state. */
+  inst_warm("x", mu);
+  inst_warm("w", nu);
+
   /* precompute a scale factor for the x-update. */
   const double Lt2 = L * tau / 2;
 
-  /* iterate. */
-  for (std::size_t it = 0; it < iters; it++) {
+  /* initialize the states of the fixed-point map, with the weight
+   * means on a log scale to keep them positive under acceleration.
+   */
+  Eigen::VectorXd s, gs;
+  s.resize(2 * n);
+  gs.resize(2 * n);
+
+  /* iterate until converged, optionally with momentum and anderson
+   * acceleration.
+   */
+  momentum acc{accel};
+  anderson aa{aa_depth};
+  converge conv;
+  active act;
+  std::size_t it = 0;
+  while (it < iters) {
+    /* restrict the iteration to the active coefficients. */
+    TRACE_PHASE(aux);
+    if (act(it, {&mu, &nu, &gamma})) {
+      acc.remap(act, mu);
+      conv.remap(act, mu, nu);
+
+      /* the anderson history spans the whole state, so restart it. */
+      aa = anderson{aa_depth};
+      s.resize(2 * n);
+      gs.resize(2 * n);
+    }
+
+    if (aa_depth)
+      s << mu, nu.array().log().matrix();
+
     /* update the mean. */
-    z = mu;
-    mu = (Lt2 * z - tau * A.transpose() * (A * z - y)).array()
-       / (Lt2 + nu.array());
+    TRACE_PHASE(x);
+    const Eigen::VectorXd& p = acc.point(mu);
+    grad(p, tau, g);
+    mu = (Lt2 * p - g).array() / (Lt2 + nu.array());
+    acc.update(mu, nu, tau);
 
     /* update the variance. */
     gamma = (nu.array() + tau * delta.array()).inverse();
 
     /* update the weight means. */
+    TRACE_PHASE(w);
     nu = (xi * (mu.array().abs2() + gamma.array()).inverse()).sqrt();
+
+    /* extrapolate the state. */
+    TRACE_PHASE(aux);
+    if (aa_depth) {
+      gs << mu, nu.array().log().matrix();
+      aa(s, gs);
+      mu = gs.head(n);
+      nu = gs.tail(n).array().exp();
+    }
+
+    /* check for convergence. */
+    TRACE_ITER(it + 1, mu, nu, tau);
+    TRACE_PHASE(check);
+    if (conv(++it, mu, nu, act))
+      break;
   }
 
+  /* return to all coefficients. */
+  act.expand({&mu, &nu, &gamma});
+
+  /* store the final state. */
+  inst_keep("x", mu);
+  inst_keep("w", nu);
+
   /* output the final mean and variance estimates. */
-  for (std::size_t i = 0; i < n; i++)
-    std::cout << mu(i) << " " << gamma(i) << "\n";
+  inst_output(out, err, mu, gamma);
+
+  /* output the number of iterations used. */
+  inst_diag(err, "iters", it);
 }
 
+int main(int argc, char **argv) {
+  /* solve the problem instance. */
+  return inst_main(argc, argv, solve);
+}